@@ -0,0 +1,95 @@
+/*
+Arena allocation for large Extended<T> buffers.
+
+Copyright 2020. Siwei Wang.
+*/
+#include "arena.h"
+#include <cstdint>
+#include <cstdlib>
+#include "infinite_error.h"
+#if defined(__linux__)
+#include <sys/mman.h>
+#endif
+
+namespace {
+size_t round_up(size_t bytes, size_t multiple) noexcept {
+  return (bytes + multiple - 1) / multiple * multiple;
+}
+}  // namespace
+
+ext::Arena::Arena(size_t chunk_bytes, bool huge_pages) noexcept
+    : m_chunk_bytes(round_up(std::max<size_t>(chunk_bytes, 1), HUGE_PAGE)),
+      m_huge_pages(huge_pages) {}
+
+ext::Arena::~Arena() { reset(); }
+
+ext::Arena::Chunk ext::Arena::map_chunk(size_t bytes) {
+  bytes = round_up(bytes, HUGE_PAGE);
+  // Reserved first so recording the mapped chunk cannot throw and leak it.
+  m_chunks.reserve(m_chunks.size() + 1);
+#if defined(__linux__)
+  // mmap only aligns to the base page, so map an extra huge page and trim
+  // both ends to leave a huge page aligned chunk.
+  const size_t mapped = bytes + HUGE_PAGE;
+  void* raw = mmap(nullptr, mapped, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (raw == MAP_FAILED) throw std::bad_alloc();
+  char* const base = static_cast<char*>(raw);
+  const auto addr = reinterpret_cast<uintptr_t>(base);
+  char* const data = base + (round_up(addr, HUGE_PAGE) - addr);
+  if (data != base) munmap(base, static_cast<size_t>(data - base));
+  char* const tail = data + bytes;
+  if (tail != base + mapped) {
+    munmap(tail, static_cast<size_t>(base + mapped - tail));
+  }
+#if defined(MADV_HUGEPAGE)
+  // Advisory only: the kernel may lack or disable transparent huge pages.
+  if (m_huge_pages) madvise(data, bytes, MADV_HUGEPAGE);
+#endif
+#else
+  char* const data = static_cast<char*>(std::aligned_alloc(HUGE_PAGE, bytes));
+  if (!data) throw std::bad_alloc();
+#endif
+  m_chunks.push_back({data, bytes});
+  m_reserved += bytes;
+  return m_chunks.back();
+}
+
+void* ext::Arena::allocate(size_t bytes, size_t align) {
+  inf_assert(align && !(align & (align - 1)) && align <= 4096,
+             "Arena error: alignment must be a power of two up to 4096.");
+  const auto cursor = reinterpret_cast<uintptr_t>(m_cursor);
+  const auto aligned = (cursor + align - 1) & ~(uintptr_t(align) - 1);
+  if (!m_cursor || aligned + bytes > reinterpret_cast<uintptr_t>(m_end)) {
+    if (bytes > m_chunk_bytes) {
+      // Oversized requests keep the current chunk for later small ones.
+      char* const own = map_chunk(bytes).data;
+      m_used += bytes;
+      return own;
+    }
+    const Chunk chunk = map_chunk(m_chunk_bytes);
+    m_cursor = chunk.data;
+    m_end = chunk.data + chunk.bytes;
+    m_used += bytes;
+    char* const out = m_cursor;
+    m_cursor += bytes;
+    return out;
+  }
+  char* const out = reinterpret_cast<char*>(aligned);
+  m_cursor = out + bytes;
+  m_used += bytes;
+  return out;
+}
+
+void ext::Arena::reset() noexcept {
+  for (const Chunk& chunk : m_chunks) {
+#if defined(__linux__)
+    munmap(chunk.data, chunk.bytes);
+#else
+    std::free(chunk.data);
+#endif
+  }
+  m_chunks.clear();
+  m_cursor = m_end = nullptr;
+  m_used = m_reserved = 0;
+}
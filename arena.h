@@ -0,0 +1,156 @@
+/*
+Arena allocation for large Extended<T> buffers. Chunks are mapped directly
+and advised to use transparent huge pages, allocation is a pointer bump,
+and everything is released at once. The allocator leaves elements
+uninitialized, so buffers can be faulted in by the threads that use them.
+
+Copyright 2020. Siwei Wang.
+*/
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "extended.h"
+
+namespace ext {
+class Arena {
+ public:
+  // Transparent huge page size on x86-64 and the chunk granularity.
+  static constexpr size_t HUGE_PAGE = size_t(2) << 20;
+
+  /**
+   * @param chunk_bytes Size of each mapped chunk, rounded up to HUGE_PAGE.
+   * @param huge_pages Whether to advise the kernel to back chunks with huge
+   * pages. Ignored where unsupported.
+   */
+  explicit Arena(size_t chunk_bytes = size_t(64) << 20,
+                 bool huge_pages = true) noexcept;
+
+  ~Arena();
+
+  Arena(const Arena&) = delete;
+  Arena& operator=(const Arena&) = delete;
+
+  /**
+   * Requests larger than a chunk get a chunk of their own. Chunks start on
+   * a HUGE_PAGE boundary.
+   * THROWS: std::bad_alloc if the system is out of memory, infinite_error
+   * if align is not a power of two or exceeds 4096.
+   * @param bytes Number of bytes.
+   * @param align Power of two alignment, at most 4096.
+   * @returns Uninitialized memory that lives until reset() or destruction.
+   */
+  void* allocate(size_t bytes, size_t align = alignof(std::max_align_t));
+
+  /**
+   * Unmaps every chunk, invalidating all allocations.
+   */
+  void reset() noexcept;
+
+  /**
+   * @returns Bytes handed out since the last reset.
+   */
+  size_t bytes_used() const noexcept { return m_used; }
+
+  /**
+   * @returns Bytes mapped for chunks.
+   */
+  size_t bytes_reserved() const noexcept { return m_reserved; }
+
+ private:
+  struct Chunk {
+    char* data;
+    size_t bytes;
+  };
+
+  std::vector<Chunk> m_chunks;
+  char* m_cursor = nullptr;
+  char* m_end = nullptr;
+  size_t m_chunk_bytes;
+  size_t m_used = 0;
+  size_t m_reserved = 0;
+  bool m_huge_pages;
+
+  Chunk map_chunk(size_t bytes);
+};
+
+/**
+ * Standard allocator drawing from an Arena. Deallocation is deferred to the
+ * arena, and value construction without arguments leaves Extended elements
+ * uninitialized, so std::vector<Extended<T>, ArenaAllocator<Extended<T>>>(n)
+ * writes nothing.
+ */
+template <typename U>
+class ArenaAllocator {
+  template <typename V>
+  friend class ArenaAllocator;
+
+  Arena* m_arena;
+
+ public:
+  using value_type = U;
+
+  explicit ArenaAllocator(Arena& arena) noexcept : m_arena(&arena) {}
+
+  template <typename V>
+  ArenaAllocator(const ArenaAllocator<V>& other) noexcept
+      : m_arena(other.m_arena) {}
+
+  U* allocate(size_t n) {
+    return static_cast<U*>(m_arena->allocate(n * sizeof(U), alignof(U)));
+  }
+
+  void deallocate(U*, size_t) noexcept {}
+
+  template <typename V, typename... Args>
+  void construct(V* ptr, Args&&... args) {
+    if constexpr (sizeof...(Args) == 0 &&
+                  std::is_constructible_v<V, Uninit>) {
+      ::new (static_cast<void*>(ptr)) V(UNINIT);
+    } else {
+      ::new (static_cast<void*>(ptr)) V(std::forward<Args>(args)...);
+    }
+  }
+
+  template <typename V>
+  bool operator==(const ArenaAllocator<V>& other) const noexcept {
+    return m_arena == other.m_arena;
+  }
+
+  template <typename V>
+  bool operator!=(const ArenaAllocator<V>& other) const noexcept {
+    return m_arena != other.m_arena;
+  }
+};
+
+template <typename T>
+using ArenaVector = std::vector<Extended<T>, ArenaAllocator<Extended<T>>>;
+
+/**
+ * Writes value to every element, each thread filling one contiguous slice.
+ * On a NUMA machine the first write places a page on the writer's node, so
+ * fill a fresh buffer with the same split as the threads that will read it.
+ * @param nums Array of sz elements, possibly uninitialized.
+ * @param sz Number of elements.
+ * @param value Value to write.
+ * @param threads Number of worker threads.
+ */
+template <typename T>
+void parallel_fill(Extended<T>* nums, size_t sz, const Extended<T>& value,
+                   size_t threads = 1) {
+  threads = std::max<size_t>(1, std::min(threads, sz));
+  const size_t per_thread = (sz + threads - 1) / threads;
+  const auto work = [&](size_t t) {
+    const size_t end = std::min(sz, (t + 1) * per_thread);
+    std::fill(nums + std::min(sz, t * per_thread), nums + end, value);
+  };
+  std::vector<std::thread> workers;
+  for (size_t t = 1; t < threads; ++t) workers.emplace_back(work, t);
+  work(0);
+  for (auto& worker : workers) worker.join();
+}
+}  // namespace ext
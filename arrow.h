@@ -0,0 +1,342 @@
+/*
+Export and import of Extended<T> columns through the Apache Arrow C Data
+Interface. See https://arrow.apache.org/docs/format/CDataInterface.html
+The interface is a pair of C structs, so no Arrow library is required.
+
+Floating point columns travel as plain Arrow arrays with IEEE infinities.
+Integer columns travel as the extension type "ext.extended", whose storage
+is a struct of the values and an int8 side buffer holding -1, 0, or 1.
+
+Copyright 2020. Siwei Wang.
+*/
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "extended.h"
+#include "infinite_error.h"
+#include "view.h"
+
+#ifndef ARROW_C_DATA_INTERFACE
+#define ARROW_C_DATA_INTERFACE
+
+#define ARROW_FLAG_DICTIONARY_ORDERED 1
+#define ARROW_FLAG_NULLABLE 2
+#define ARROW_FLAG_MAP_KEYS_SORTED 4
+
+extern "C" {
+struct ArrowSchema {
+  const char* format;
+  const char* name;
+  const char* metadata;
+  int64_t flags;
+  int64_t n_children;
+  struct ArrowSchema** children;
+  struct ArrowSchema* dictionary;
+  void (*release)(struct ArrowSchema*);
+  void* private_data;
+};
+
+struct ArrowArray {
+  int64_t length;
+  int64_t null_count;
+  int64_t offset;
+  int64_t n_buffers;
+  int64_t n_children;
+  const void** buffers;
+  struct ArrowArray** children;
+  struct ArrowArray* dictionary;
+  void (*release)(struct ArrowArray*);
+  void* private_data;
+};
+}
+
+#endif  // ARROW_C_DATA_INTERFACE
+
+namespace ext {
+/**
+ * Int8 side buffer: -1 for -inf, 0 for finite, and 1 for +inf.
+ */
+template <typename T>
+struct SignEncoding {
+  const int8_t* signs;
+
+  bool finite(const T*, size_t idx) const noexcept { return !signs[idx]; }
+
+  Extended<T> decode(const T* data, size_t idx) const noexcept {
+    if (!signs[idx]) return Extended<T>(data[idx]);
+    return Extended<T>(signs[idx] > 0 ? INF::POS : INF::NEG);
+  }
+};
+
+namespace arrow {
+// Extension name placed in the schema metadata of integer columns.
+static constexpr const char* EXTENSION_NAME = "ext.extended";
+
+/**
+ * @returns The Arrow format string of a primitive T.
+ */
+template <typename T>
+const char* format() noexcept {
+  static_assert(sizeof(T) <= 8 && (std::is_integral_v<T> || sizeof(T) >= 4),
+                "Arrow export requires an integer, float, or double.");
+  constexpr bool is_signed = std::is_signed_v<T>;
+  if constexpr (std::is_same_v<T, float>) {
+    return "f";
+  } else if constexpr (std::is_same_v<T, double>) {
+    return "g";
+  } else if constexpr (sizeof(T) == 1) {
+    return is_signed ? "c" : "C";
+  } else if constexpr (sizeof(T) == 2) {
+    return is_signed ? "s" : "S";
+  } else if constexpr (sizeof(T) == 4) {
+    return is_signed ? "i" : "I";
+  } else {
+    return is_signed ? "l" : "L";
+  }
+}
+
+/**
+ * Arrow metadata encoding a single key-value pair: int32 pair count, then
+ * the int32-length-prefixed key and value.
+ */
+inline std::string metadata(const std::string& key, const std::string& val) {
+  std::string out;
+  const auto append_int = [&out](size_t num) {
+    const auto len = static_cast<int32_t>(num);
+    out.append(reinterpret_cast<const char*>(&len), sizeof(len));
+  };
+  append_int(1);
+  append_int(key.size());
+  out += key;
+  append_int(val.size());
+  out += val;
+  return out;
+}
+
+/**
+ * Owner of exported buffers. The parent array's release frees it.
+ */
+template <typename T>
+struct ArrayHolder {
+  std::vector<T> values;
+  std::vector<int8_t> signs;
+  const void* parent_buffers[1] = {nullptr};
+  const void* value_buffers[2] = {nullptr, nullptr};
+  const void* sign_buffers[2] = {nullptr, nullptr};
+  ArrowArray value_child{};
+  ArrowArray sign_child{};
+  ArrowArray* child_ptrs[2] = {&value_child, &sign_child};
+};
+
+/**
+ * Owner of exported schema strings and children.
+ */
+struct SchemaHolder {
+  std::string metadata;
+  ArrowSchema value_child{};
+  ArrowSchema sign_child{};
+  ArrowSchema* child_ptrs[2] = {&value_child, &sign_child};
+};
+
+// Children are owned by their parent and released along with it.
+inline void release_child(ArrowArray* array) { array->release = nullptr; }
+
+inline void release_child(ArrowSchema* schema) { schema->release = nullptr; }
+
+template <typename T>
+void release_array(ArrowArray* array) {
+  for (int64_t c = 0; c < array->n_children; ++c) {
+    auto* child = array->children[c];
+    if (child->release) child->release(child);
+  }
+  delete static_cast<ArrayHolder<T>*>(array->private_data);
+  array->release = nullptr;
+}
+
+inline void release_schema(ArrowSchema* schema) {
+  for (int64_t c = 0; c < schema->n_children; ++c) {
+    auto* child = schema->children[c];
+    if (child->release) child->release(child);
+  }
+  delete static_cast<SchemaHolder*>(schema->private_data);
+  schema->release = nullptr;
+}
+
+/**
+ * Fills a primitive array with no nulls over values.
+ */
+inline void primitive(ArrowArray* array, int64_t length, const void** buffers,
+                      const void* values) {
+  *array = ArrowArray{};
+  array->length = length;
+  array->n_buffers = 2;
+  buffers[0] = nullptr;
+  buffers[1] = values;
+  array->buffers = buffers;
+}
+}  // namespace arrow
+
+/**
+ * Moves column into Arrow arrays. The elements are converted to columnar
+ * buffers in one pass, and those buffers are handed to the consumer, who
+ * frees them by calling the release callbacks.
+ * @param column The column to export.
+ * @param array Output array. The consumer must call array->release.
+ * @param schema Output schema. The consumer must call schema->release.
+ */
+template <typename T>
+void export_column(std::vector<Extended<T>> column, ArrowArray* array,
+                   ArrowSchema* schema) {
+  const auto length = static_cast<int64_t>(column.size());
+  // Owned here until both structs are filled, so a throw leaks nothing.
+  auto arr_holder = std::make_unique<arrow::ArrayHolder<T>>();
+  auto sch_holder = std::make_unique<arrow::SchemaHolder>();
+  arr_holder->values.resize(column.size());
+  *schema = ArrowSchema{};
+  schema->name = "";
+
+  if constexpr (std::is_floating_point_v<T>) {
+    constexpr T huge = std::numeric_limits<T>::infinity();
+    for (size_t i = 0; i < column.size(); ++i) {
+      const int sign = column[i].inf_sign();
+      arr_holder->values[i] =
+          sign == 0 ? column[i].raw_value() : (sign > 0 ? huge : -huge);
+    }
+    arrow::primitive(array, length, arr_holder->value_buffers,
+                     arr_holder->values.data());
+    schema->format = arrow::format<T>();
+  } else {
+    arr_holder->signs.resize(column.size());
+    for (size_t i = 0; i < column.size(); ++i) {
+      const int sign = column[i].inf_sign();
+      arr_holder->values[i] = sign == 0 ? column[i].raw_value() : T(0);
+      arr_holder->signs[i] = static_cast<int8_t>(sign);
+    }
+    arrow::primitive(&arr_holder->value_child, length,
+                     arr_holder->value_buffers, arr_holder->values.data());
+    arrow::primitive(&arr_holder->sign_child, length,
+                     arr_holder->sign_buffers, arr_holder->signs.data());
+    arr_holder->value_child.release = arrow::release_child;
+    arr_holder->sign_child.release = arrow::release_child;
+    *array = ArrowArray{};
+    array->length = length;
+    array->n_buffers = 1;
+    array->buffers = arr_holder->parent_buffers;
+    array->n_children = 2;
+    array->children = arr_holder->child_ptrs;
+
+    sch_holder->metadata =
+        arrow::metadata("ARROW:extension:name", arrow::EXTENSION_NAME);
+    schema->format = "+s";
+    schema->metadata = sch_holder->metadata.data();
+    schema->n_children = 2;
+    schema->children = sch_holder->child_ptrs;
+    auto& value_schema = sch_holder->value_child;
+    value_schema.format = arrow::format<T>();
+    value_schema.name = "value";
+    value_schema.release = arrow::release_child;
+    auto& sign_schema = sch_holder->sign_child;
+    sign_schema.format = "c";
+    sign_schema.name = "inf";
+    sign_schema.release = arrow::release_child;
+  }
+  array->release = arrow::release_array<T>;
+  array->private_data = arr_holder.release();
+  schema->release = arrow::release_schema;
+  schema->private_data = sch_holder.release();
+}
+
+/**
+ * Column imported from Arrow without copying. Owns the imported array and
+ * releases it on destruction.
+ */
+template <typename T>
+class ImportedColumn {
+ public:
+  using encoding_type = std::conditional_t<std::is_floating_point_v<T>,
+                                           IeeeEncoding<T>, SignEncoding<T>>;
+
+ private:
+  ArrowArray m_array;
+  ExtendedView<T, encoding_type> m_view;
+
+ public:
+  ImportedColumn(ArrowArray* array, ExtendedView<T, encoding_type> view)
+      : m_array(*array), m_view(view) {
+    // Ownership moves here, as the C Data Interface specifies.
+    array->release = nullptr;
+  }
+
+  ImportedColumn(const ImportedColumn&) = delete;
+  ImportedColumn& operator=(const ImportedColumn&) = delete;
+
+  ImportedColumn(ImportedColumn&& other) noexcept
+      : m_array(other.m_array), m_view(other.m_view) {
+    other.m_array.release = nullptr;
+  }
+
+  ~ImportedColumn() {
+    if (m_array.release) m_array.release(&m_array);
+  }
+
+  size_t size() const noexcept { return m_view.size(); }
+
+  Extended<T> operator[](size_t idx) const noexcept { return m_view[idx]; }
+
+  /**
+   * @returns A view over the imported buffers, valid while this lives.
+   */
+  const ExtendedView<T, encoding_type>& view() const noexcept {
+    return m_view;
+  }
+};
+
+/**
+ * Takes ownership of array, whose layout must match what export_column
+ * produces for T.
+ * THROWS: infinite_error if the schema does not describe such a column or
+ * if the array has nulls.
+ * @param array The array to import. Released by the returned column.
+ * @param schema The schema of array. Still owned by the caller.
+ * @returns The imported column.
+ */
+template <typename T>
+ImportedColumn<T> import_column(ArrowArray* array, const ArrowSchema* schema) {
+  inf_assert(array->release && schema->release,
+             "Arrow error: array or schema already released.");
+  inf_assert(array->null_count == 0, "Arrow error: nulls are not supported.");
+  const auto length = static_cast<size_t>(array->length);
+  const auto offset = static_cast<size_t>(array->offset);
+  using Column = ImportedColumn<T>;
+  using View = ExtendedView<T, typename Column::encoding_type>;
+  if constexpr (std::is_floating_point_v<T>) {
+    inf_assert(std::strcmp(schema->format, arrow::format<T>()) == 0 &&
+                   array->n_buffers == 2,
+               "Arrow error: format does not match the column type.");
+    const auto* values = static_cast<const T*>(array->buffers[1]);
+    return Column(array, View(values + offset, length));
+  } else {
+    inf_assert(std::strcmp(schema->format, "+s") == 0 &&
+                   schema->n_children == 2 &&
+                   std::strcmp(schema->children[0]->format,
+                               arrow::format<T>()) == 0 &&
+                   std::strcmp(schema->children[1]->format, "c") == 0,
+               "Arrow error: schema is not an extended integer column.");
+    const ArrowArray* value_child = array->children[0];
+    const ArrowArray* sign_child = array->children[1];
+    inf_assert(value_child->null_count == 0 && sign_child->null_count == 0,
+               "Arrow error: nulls are not supported.");
+    const auto* values = static_cast<const T*>(value_child->buffers[1]) +
+                         offset + static_cast<size_t>(value_child->offset);
+    const auto* signs = static_cast<const int8_t*>(sign_child->buffers[1]) +
+                        offset + static_cast<size_t>(sign_child->offset);
+    return Column(array, View(values, length, SignEncoding<T>{signs}));
+  }
+}
+}  // namespace ext
@@ -0,0 +1,297 @@
+/*
+Minimum cost assignment over dense Extended<T> cost matrices, where +inf
+marks a forbidden pairing. Forbidden entries are never selected, and a
+matrix without a finite perfect assignment is reported as infeasible, so no
+big-M constant is needed.
+
+Copyright 2020. Siwei Wang.
+*/
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <limits>
+#include <thread>
+#include <type_traits>
+#include <vector>
+#include "extended.h"
+
+namespace ext {
+template <typename T>
+struct Assignment {
+  // Column assigned to each row. Empty if infeasible.
+  std::vector<size_t> column_of;
+  // Total cost, +inf if infeasible.
+  Extended<T> cost{INF::POS};
+
+  bool feasible() const noexcept { return cost.finite(); }
+};
+
+namespace detail {
+template <typename T>
+Assignment<T> make_assignment(const Extended<T>* costs, size_t n,
+                              std::vector<size_t> column_of) {
+  Assignment<T> result;
+  result.cost = Extended<T>();
+  for (size_t i = 0; i < n; ++i) result.cost += costs[i * n + column_of[i]];
+  result.column_of = std::move(column_of);
+  return result;
+}
+
+/**
+ * Hopcroft-Karp over the finite entries.
+ * @returns Whether every row can be matched to a distinct column.
+ */
+template <typename T>
+bool perfectly_matchable(const Extended<T>* costs, size_t n) {
+  constexpr size_t NONE = std::numeric_limits<size_t>::max();
+  std::vector<std::vector<size_t>> adj(n);
+  for (size_t i = 0; i < n; ++i) {
+    for (size_t j = 0; j < n; ++j) {
+      if (costs[i * n + j].finite()) adj[i].push_back(j);
+    }
+    if (adj[i].empty()) return false;
+  }
+  std::vector<size_t> row_of(n, NONE), col_of(n, NONE), dist(n), arc(n);
+  size_t matched = 0;
+  while (true) {
+    // Layer free rows, then search shortest augmenting paths.
+    std::deque<size_t> queue;
+    for (size_t i = 0; i < n; ++i) {
+      dist[i] = col_of[i] == NONE ? 0 : NONE;
+      if (col_of[i] == NONE) queue.push_back(i);
+    }
+    bool found = false;
+    while (!queue.empty()) {
+      const size_t i = queue.front();
+      queue.pop_front();
+      for (const size_t j : adj[i]) {
+        const size_t next = row_of[j];
+        if (next == NONE) {
+          found = true;
+        } else if (dist[next] == NONE) {
+          dist[next] = dist[i] + 1;
+          queue.push_back(next);
+        }
+      }
+    }
+    if (!found) return matched == n;
+    std::fill(arc.begin(), arc.end(), 0);
+    for (size_t root = 0; root < n; ++root) {
+      if (col_of[root] != NONE) continue;
+      std::vector<size_t> path{root};
+      while (!path.empty()) {
+        const size_t i = path.back();
+        if (arc[i] == adj[i].size()) {
+          dist[i] = NONE;
+          path.pop_back();
+          continue;
+        }
+        const size_t j = adj[i][arc[i]++];
+        const size_t next = row_of[j];
+        if (next == NONE) {
+          // Flip the path: each row takes the column it reached.
+          for (size_t k = path.size(); k-- > 0;) {
+            const size_t row = path[k];
+            const size_t col = adj[row][arc[row] - 1];
+            row_of[col] = row;
+            col_of[row] = col;
+          }
+          ++matched;
+          break;
+        }
+        if (dist[next] == dist[i] + 1) path.push_back(next);
+      }
+    }
+  }
+}
+}  // namespace detail
+
+/**
+ * Hungarian algorithm with row and column potentials, in O(n^3) time. Each
+ * row is added by a shortest augmenting path over the finite entries.
+ * REQUIRES: T is signed, since potentials go negative.
+ * @param costs Row-major n by n matrix.
+ * @param n Number of rows and columns.
+ * @returns An optimal assignment, or an infeasible one.
+ */
+template <typename T>
+Assignment<T> hungarian(const Extended<T>* costs, size_t n) {
+  static_assert(std::is_signed_v<T>, "Hungarian requires signed costs.");
+  // Column 0 is a sentinel holding the row being added.
+  std::vector<T> row_pot(n + 1, T(0)), col_pot(n + 1, T(0)), slack(n + 1);
+  std::vector<size_t> row_at(n + 1, 0), way(n + 1, 0);
+  std::vector<char> used(n + 1), reached(n + 1);
+  for (size_t row = 1; row <= n; ++row) {
+    row_at[0] = row;
+    size_t col = 0;
+    std::fill(used.begin(), used.end(), 0);
+    std::fill(reached.begin(), reached.end(), 0);
+    do {
+      used[col] = 1;
+      const size_t i = row_at[col];
+      const Extended<T>* line = costs + (i - 1) * n;
+      bool any = false;
+      T delta = T(0);
+      size_t next = 0;
+      for (size_t j = 1; j <= n; ++j) {
+        if (used[j]) continue;
+        if (line[j - 1].finite()) {
+          const T reduced = static_cast<T>(line[j - 1].raw_value() -
+                                           row_pot[i] - col_pot[j]);
+          if (!reached[j] || reduced < slack[j]) {
+            slack[j] = reduced;
+            way[j] = col;
+            reached[j] = 1;
+          }
+        }
+        if (reached[j] && (!any || slack[j] < delta)) {
+          delta = slack[j];
+          next = j;
+          any = true;
+        }
+      }
+      // Every finite entry from the tree leads to a used column.
+      if (!any) return Assignment<T>();
+      for (size_t j = 0; j <= n; ++j) {
+        if (used[j]) {
+          row_pot[row_at[j]] = static_cast<T>(row_pot[row_at[j]] + delta);
+          col_pot[j] = static_cast<T>(col_pot[j] - delta);
+        } else if (reached[j]) {
+          slack[j] = static_cast<T>(slack[j] - delta);
+        }
+      }
+      col = next;
+    } while (row_at[col] != 0);
+    do {
+      const size_t prev = way[col];
+      row_at[col] = row_at[prev];
+      col = prev;
+    } while (col != 0);
+  }
+  std::vector<size_t> column_of(n);
+  for (size_t j = 1; j <= n; ++j) column_of[row_at[j] - 1] = j - 1;
+  return detail::make_assignment(costs, n, std::move(column_of));
+}
+
+/**
+ * Forward auction with epsilon scaling. Costs are scaled by n + 1 so the
+ * final epsilon of 1 gives an optimal assignment. Feasibility is checked
+ * first with Hopcroft-Karp, since prices would otherwise rise forever. In
+ * each round the unassigned rows bid in parallel and the bids are settled
+ * in order.
+ * REQUIRES: (n + 1) times the finite cost range fits in int64_t.
+ * @param costs Row-major n by n matrix.
+ * @param n Number of rows and columns.
+ * @param threads Number of worker threads.
+ * @returns An optimal assignment, or an infeasible one.
+ */
+template <typename T>
+Assignment<T> auction(const Extended<T>* costs, size_t n,
+                      size_t threads = 1) {
+  static_assert(std::is_integral_v<T>,
+                "Auction requires integer costs. Use hungarian.");
+  if (!detail::perfectly_matchable(costs, n)) return Assignment<T>();
+  constexpr size_t NONE = std::numeric_limits<size_t>::max();
+  const auto scale = static_cast<int64_t>(n + 1);
+  // Benefits are negated, scaled costs; forbidden entries never bid.
+  int64_t lowest = 0, highest = 0;
+  bool any = false;
+  for (size_t k = 0; k < n * n; ++k) {
+    if (!costs[k].finite()) continue;
+    const auto benefit = -static_cast<int64_t>(costs[k].raw_value()) * scale;
+    lowest = any ? std::min(lowest, benefit) : benefit;
+    highest = any ? std::max(highest, benefit) : benefit;
+    any = true;
+  }
+  const int64_t spread = highest - lowest;
+
+  std::vector<int64_t> price(n, 0);
+  std::vector<size_t> column_of(n), row_of(n);
+  std::vector<size_t> bid_col(n);
+  std::vector<int64_t> bid_val(n);
+  std::vector<size_t> unassigned;
+  std::vector<int64_t> best_bid(n);
+  std::vector<size_t> best_row(n, NONE);
+  int64_t eps = std::max<int64_t>(1, spread / 4);
+  while (true) {
+    std::fill(column_of.begin(), column_of.end(), NONE);
+    std::fill(row_of.begin(), row_of.end(), NONE);
+    unassigned.resize(n);
+    for (size_t i = 0; i < n; ++i) unassigned[i] = n - 1 - i;
+    while (!unassigned.empty()) {
+      const auto bid = [&](size_t first, size_t last) {
+        for (size_t k = first; k < last; ++k) {
+          const size_t i = unassigned[k];
+          const Extended<T>* line = costs + i * n;
+          int64_t best = 0, second = 0;
+          size_t target = NONE;
+          bool has_second = false;
+          for (size_t j = 0; j < n; ++j) {
+            if (!line[j].finite()) continue;
+            const int64_t value =
+                -static_cast<int64_t>(line[j].raw_value()) * scale - price[j];
+            if (target == NONE || best < value) {
+              if (target != NONE) {
+                second = has_second ? std::max(second, best) : best;
+                has_second = true;
+              }
+              best = value;
+              target = j;
+            } else if (!has_second || second < value) {
+              second = value;
+              has_second = true;
+            }
+          }
+          // A lone option may be bid up by any finite amount.
+          bid_col[k] = target;
+          bid_val[k] = price[target] + best -
+                       (has_second ? second : best - spread) + eps;
+        }
+      };
+      const size_t count = unassigned.size();
+      const size_t workers_wanted =
+          std::max<size_t>(1, std::min(threads, count / 64));
+      const size_t per_worker = (count + workers_wanted - 1) / workers_wanted;
+      std::vector<std::thread> workers;
+      for (size_t t = 1; t < workers_wanted; ++t) {
+        workers.emplace_back(bid, std::min(count, t * per_worker),
+                             std::min(count, (t + 1) * per_worker));
+      }
+      bid(0, std::min(count, per_worker));
+      for (auto& worker : workers) worker.join();
+
+      // Settle: each column goes to its highest bidder.
+      for (size_t k = 0; k < count; ++k) {
+        const size_t j = bid_col[k];
+        if (best_row[j] == NONE || best_bid[j] < bid_val[k]) {
+          best_bid[j] = bid_val[k];
+          best_row[j] = unassigned[k];
+        }
+      }
+      std::vector<size_t> still;
+      for (size_t k = 0; k < count; ++k) {
+        const size_t i = unassigned[k];
+        const size_t j = bid_col[k];
+        if (best_row[j] != i) {
+          still.push_back(i);
+          continue;
+        }
+        if (row_of[j] != NONE) {
+          column_of[row_of[j]] = NONE;
+          still.push_back(row_of[j]);
+        }
+        row_of[j] = i;
+        column_of[i] = j;
+        price[j] = best_bid[j];
+      }
+      for (size_t k = 0; k < count; ++k) best_row[bid_col[k]] = NONE;
+      unassigned.swap(still);
+    }
+    if (eps == 1) break;
+    eps = std::max<int64_t>(1, eps / 4);
+  }
+  return detail::make_assignment(costs, n, std::move(column_of));
+}
+}  // namespace ext
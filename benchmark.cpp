@@ -6,26 +6,58 @@ Copyright 2020. Siwei Wang.
 #include <algorithm>
 #include <chrono>
 #include <functional>
+#include <iomanip>
 #include <iostream>
 #include <iterator>
+#include <map>
 #include <numeric>
-#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unordered_map>
 #include <utility>
 #include <vector>
+#include "arena.h"
+#include "assignment.h"
+#include "broadcast.h"
+#include "compare.h"
+#include "compressed.h"
+#include "conformance.h"
+#include "dispatch.h"
+#include "expression.h"
 #include "extended.h"
+#include "flow.h"
+#include "fma.h"
+#include "group_by.h"
 #include "infinite_error.h"
+#include "instrument.h"
+#include "minplus.h"
+#include "perf_counters.h"
+#include "sparse.h"
 #include "test.h"
+#include "timer_wheel.h"
+#include "view.h"
+#include "workload.h"
 using std::accumulate;
 using std::back_inserter;
+using std::count;
 using std::cout;
-using std::default_random_engine;
+using std::fill;
+using std::fixed;
 using std::function;
-using std::generate;
 using std::ios_base;
+using std::left;
 using std::make_pair;
+using std::multimap;
+using std::ostringstream;
 using std::pair;
+using std::right;
+using std::setprecision;
+using std::setw;
+using std::string;
+using std::thread;
 using std::transform;
-using std::uniform_int_distribution;
+using std::unordered_map;
 using std::vector;
 using std::chrono::duration_cast;
 using std::chrono::high_resolution_clock;
@@ -34,14 +66,13 @@ using dur_t = std::chrono::microseconds;
 static constexpr auto dur_s = "microseconds";
 
 /**
- * Generate sz numbers in [min_val, max_val].
- * @param sz The size of the random vector.
+ * Each benchmark seeds its own workload, so runs are reproducible.
+ * @param seed The benchmark's seed.
  * @param min_val The minimal value.
  * @param max_val The maximal value.
- * @returns A random vector.
+ * @returns A uniform workload configuration over [min_val, max_val].
  */
-template <typename T>
-vector<T> random_numbers(size_t sz, T min_val, T max_val);
+ext::WorkloadConfig uniform(uint64_t seed, double min_val, double max_val);
 
 /**
  * Convert integer vector into extended numbers.
@@ -59,6 +90,20 @@ vector<Extended<T>> extend(const vector<T>& original);
 template <typename T>
 pair<T, T> operate(const vector<T>& numbers);
 
+/**
+ * @param func The work to time.
+ * @returns Wall-clock duration of func in dur_t units.
+ */
+template <typename Func>
+int64_t time_it(Func func);
+
+/**
+ * Prints primitive and extended hardware counts per element side by side,
+ * or notes that only wall clock time is available.
+ */
+void print_counters(const PerfCounters& counters, const uint64_t* num_counts,
+                    const uint64_t* ext_counts, size_t sz);
+
 int main() {
   ios_base::sync_with_stdio(false);
 
@@ -70,7 +115,32 @@ int main() {
       {"addition and subtraction", test::add_subtract},
       {"multiplication and division", test::multiply_divide},
       {"finite value operations", test::finite_ops},
-      {"stream insertion and extraction", test::stream}};
+      {"stream insertion and extraction", test::stream},
+      {"hashing and key encoding", test::hashing},
+      {"batch comparison kernels", test::batch_compare},
+      {"zone map summaries", test::zone_map},
+      {"mixed operand arithmetic", test::mixed_operand},
+      {"expression templates", test::expression},
+      {"fused multiply-add", test::fused},
+      {"compensated summation", test::summation},
+      {"extended math functions", test::math},
+      {"interval arithmetic", test::interval},
+      {"streaming statistics", test::statistics},
+      {"zero-copy views", test::view},
+      {"arrow interchange", test::arrow},
+      {"compressed columns", test::compressed},
+      {"sparse infinities", test::sparse},
+      {"group by aggregation", test::group_by},
+      {"runtime dispatch", test::dispatch},
+      {"hardware counters", test::perf_counters},
+      {"arena allocation", test::arena},
+      {"timer wheel", test::timer_wheel},
+      {"maximum flow", test::max_flow},
+      {"assignment", test::assignment},
+      {"min-plus convolution", test::minplus},
+      {"conformance", test::conformance},
+      {"instrumentation", test::instrument},
+      {"workload", test::workload}};
   size_t counter = 0;
   for (const auto& t_name_func : tests) {
     cout << "Test " << t_name_func.first;
@@ -97,36 +167,489 @@ int main() {
   cout << "\n--- PERFORMANCE BENCHMARKS ---\n";
   constexpr size_t sz = 4000000;
   cout << "Time measured in " << dur_s << " on sample size of " << sz << '\n';
-  const auto num_sample = random_numbers<int64_t>(sz, -1000, 1000);
+  const auto num_sample = ext::generate_numbers<int64_t>(
+      sz, uniform(1, -1000, 1000), thread::hardware_concurrency());
   const auto ext_sample = extend(num_sample);
 
+  PerfCounters counters;
+  uint64_t num_counts[PerfCounters::NUM_EVENTS];
+  uint64_t ext_counts[PerfCounters::NUM_EVENTS];
+  const auto record = [&counters](uint64_t* counts) {
+    for (size_t e = 0; e < PerfCounters::NUM_EVENTS; ++e) {
+      counts[e] = counters.value(static_cast<PerfCounters::Event>(e));
+    }
+  };
+
+  counters.start();
   const auto begin = high_resolution_clock::now();
   const auto num_result = operate(num_sample);
   const auto middle = high_resolution_clock::now();
+  counters.stop();
+  record(num_counts);
+  counters.start();
+  const auto middle_ext = high_resolution_clock::now();
   const auto ext_result = operate(ext_sample);
   const auto end = high_resolution_clock::now();
+  counters.stop();
+  record(ext_counts);
 
   const auto num_time = duration_cast<dur_t>(middle - begin).count();
-  const auto ext_time = duration_cast<dur_t>(end - middle).count();
+  const auto ext_time = duration_cast<dur_t>(end - middle_ext).count();
   cout << "Primitive time: " << num_time << '\n';
   cout << "Extended time: " << ext_time << '\n';
+  print_counters(counters, num_counts, ext_counts, sz);
 
   assert(num_result.first == ext_result.first.value(),
          "Benchmark sums do no agree.");
   assert(num_result.second == ext_result.second.value(),
          "Benchmark products do no agree.");
   cout << "Sanity check succeeded\n";
+
+  cout << "\n--- FILTER BENCHMARKS ---\n";
+  // Both passes stream 16 bytes per element, so at this size they meet the
+  // same memory bandwidth floor and take about as long. The kernel pays off
+  // when the mask is reused, and with the wider dispatched kernels.
+  const Extended<int64_t> threshold(0);
+  size_t op_count = 0;
+  const auto op_time = time_it([&]() {
+    for (const auto& ext : ext_sample) op_count += ext < threshold;
+  });
+  vector<uint64_t> mask(ext::mask_words(sz));
+  size_t kernel_count = 0;
+  const auto kernel_time = time_it([&]() {
+    ext::compare_lt(ext_sample.data(), sz, threshold, mask.data());
+    kernel_count = ext::count_selected(mask.data(), sz);
+  });
+  cout << "Operator filter time: " << op_time << '\n';
+  cout << "Kernel filter time: " << kernel_time << '\n';
+  assert(op_count == kernel_count, "Filter counts do not agree.");
+  cout << "Sanity check succeeded\n";
+
+  cout << "\n--- BROADCAST BENCHMARKS ---\n";
+  auto wide_scaled = ext_sample;
+  auto mixed_scaled = ext_sample;
+  const Extended<int64_t> wide_factor(3);
+  const auto wide_time = time_it([&]() {
+    for (auto& ext : wide_scaled) ext *= wide_factor;
+  });
+  const auto mixed_time =
+      time_it([&]() { ext::scale(mixed_scaled.data(), sz, int64_t(3)); });
+  cout << "Extended operand scale time: " << wide_time << '\n';
+  cout << "Mixed operand scale time: " << mixed_time << '\n';
+  assert(wide_scaled == mixed_scaled, "Scaled results do not agree.");
+  cout << "Sanity check succeeded\n";
+
+  cout << "\n--- EXPRESSION BENCHMARKS ---\n";
+  vector<Extended<int64_t>> chained;
+  const auto chained_time = time_it([&]() {
+    vector<Extended<int64_t>> prod(sz), total(sz);
+    for (size_t i = 0; i < sz; ++i) prod[i] = ext_sample[i] * ext_sample[i];
+    for (size_t i = 0; i < sz; ++i) total[i] = prod[i] + ext_sample[i];
+    for (size_t i = 0; i < sz; ++i) total[i] = total[i] - wide_factor;
+    chained = std::move(total);
+  });
+  vector<Extended<int64_t>> fused;
+  const auto fused_time = time_it([&]() {
+    const auto xs = ext::lazy(ext_sample);
+    fused = ext::evaluate(xs * xs + xs - wide_factor);
+  });
+  cout << "Chained array time: " << chained_time << '\n';
+  cout << "Fused expression time: " << fused_time << '\n';
+  assert(chained == fused, "Expression results do not agree.");
+  cout << "Sanity check succeeded\n";
+
+  cout << "\n--- DOT PRODUCT BENCHMARKS ---\n";
+  Extended<int64_t> op_dot;
+  const auto op_dot_time = time_it([&]() {
+    for (const auto& ext : ext_sample) op_dot += ext * ext;
+  });
+  Extended<int64_t> kernel_dot;
+  const auto kernel_dot_time = time_it([&]() {
+    kernel_dot = ext::dot(ext_sample.data(), ext_sample.data(), sz);
+  });
+  cout << "Operator dot time: " << op_dot_time << '\n';
+  cout << "Kernel dot time: " << kernel_dot_time << '\n';
+  assert(op_dot == kernel_dot, "Dot products do not agree.");
+  cout << "Sanity check succeeded\n";
+
+  cout << "\n--- VIEW BENCHMARKS ---\n";
+  Extended<int64_t> copy_sum;
+  const auto copy_time = time_it([&]() {
+    const auto copied = extend(num_sample);
+    copy_sum = accumulate(copied.begin(), copied.end(), Extended<int64_t>());
+  });
+  Extended<int64_t> view_sum;
+  const auto view_time = time_it(
+      [&]() { view_sum = ext::sum(ext::view(num_sample.data(), sz)); });
+  cout << "Copy and sum time: " << copy_time << '\n';
+  cout << "View sum time: " << view_time << '\n';
+  assert(copy_sum == view_sum, "View sums do not agree.");
+  cout << "Sanity check succeeded\n";
+
+  cout << "\n--- COMPRESSION BENCHMARKS ---\n";
+  const ext::CompressedColumn<int64_t> column(ext_sample.data(), sz);
+  cout << "Compressed size: " << column.bytes() << " bytes, "
+       << sz * sizeof(Extended<int64_t>) << " uncompressed\n";
+  Extended<int64_t> ext_sum;
+  const auto ext_sum_time = time_it([&]() {
+    ext_sum = accumulate(ext_sample.begin(), ext_sample.end(),
+                         Extended<int64_t>());
+  });
+  Extended<int64_t> compressed_sum;
+  const auto compressed_time =
+      time_it([&]() { compressed_sum = column.sum(); });
+  cout << "Extended sum time: " << ext_sum_time << '\n';
+  cout << "Compressed sum time: " << compressed_time << '\n';
+  assert(ext_sum == compressed_sum, "Compressed sums do not agree.");
+  cout << "Sanity check succeeded\n";
+
+  cout << "\n--- SPARSE BENCHMARKS ---\n";
+  const ext::SparseInfArray<int64_t> sparse(ext_sample.data(), sz);
+  Extended<int64_t> sparse_sum;
+  const auto sparse_time = time_it([&]() { sparse_sum = sparse.sum(); });
+  vector<Extended<int64_t>> dense_squares;
+  const auto dense_product = time_it([&]() {
+    dense_squares = ext_sample;
+    for (size_t i = 0; i < sz; ++i) dense_squares[i] *= ext_sample[i];
+  });
+  ext::SparseInfArray<int64_t> sparse_squares;
+  const auto sparse_product =
+      time_it([&]() { sparse_squares = sparse * sparse; });
+  cout << "Extended sum time: " << ext_sum_time << '\n';
+  cout << "Sparse sum time: " << sparse_time << '\n';
+  cout << "Extended elementwise product time: " << dense_product << '\n';
+  cout << "Sparse elementwise product time: " << sparse_product << '\n';
+  assert(ext_sum == sparse_sum, "Sparse sums do not agree.");
+  for (size_t i = 0; i < sz; ++i) {
+    assert(dense_squares[i] == sparse_squares[i],
+           "Sparse products do not agree.");
+  }
+  cout << "Sanity check succeeded\n";
+
+  cout << "\n--- GROUP BY BENCHMARKS ---\n";
+  unordered_map<int64_t, Extended<int64_t>> map_groups;
+  const auto map_time = time_it([&]() {
+    for (size_t i = 0; i < sz; ++i) {
+      map_groups[num_sample[i]] += ext_sample[sz - 1 - i];
+    }
+  });
+  const vector<Extended<int64_t>> reversed(ext_sample.rbegin(),
+                                           ext_sample.rend());
+  vector<ext::Group<int64_t, int64_t>> hash_groups;
+  const auto hash_time = time_it([&]() {
+    hash_groups = ext::group_by(num_sample.data(), reversed.data(), sz,
+                                thread::hardware_concurrency());
+  });
+  cout << "Unordered map time: " << map_time << '\n';
+  cout << "Hash aggregation time: " << hash_time << '\n';
+  assert(hash_groups.size() == map_groups.size(), "Group counts differ.");
+  for (const auto& group : hash_groups) {
+    assert(group.aggregate.sum() == map_groups.at(group.key),
+           "Group sums do not agree.");
+  }
+  cout << "Sanity check succeeded\n";
+
+  cout << "\n--- DISPATCH BENCHMARKS ---\n";
+  cout << "Detected " << ext::isa_name(ext::detected_isa()) << '\n';
+  ostringstream text;
+  for (const auto num : num_sample) text << num << ' ';
+  const string sample_text = text.str();
+  vector<Extended<int64_t>> converted(sz);
+  for (int level = 0; level <= static_cast<int>(ext::detected_isa());
+       ++level) {
+    ext::force_isa(static_cast<ext::Isa>(level));
+    const auto& kernels = ext::kernels<int64_t>();
+    Extended<int64_t> kernel_sum, kernel_prod;
+    size_t parsed = 0;
+    const auto sum_time =
+        time_it([&]() { kernel_sum = kernels.sum(ext_sample.data(), sz); });
+    const auto prod_time = time_it(
+        [&]() { kernel_prod = kernels.product(ext_sample.data(), sz); });
+    const auto cmp_time = time_it([&]() {
+      kernels.compare_lt(ext_sample.data(), sz, threshold, mask.data());
+    });
+    const auto convert_time = time_it(
+        [&]() { kernels.convert(num_sample.data(), sz, converted.data()); });
+    const auto parse_time = time_it([&]() {
+      parsed = kernels.parse(sample_text.data(), sample_text.size(),
+                             converted.data(), sz);
+    });
+    cout << ext::isa_name(ext::active_isa()) << " sum: " << sum_time
+         << ", product: " << prod_time << ", compare: " << cmp_time
+         << ", convert: " << convert_time << ", parse: " << parse_time
+         << '\n';
+    assert(kernel_sum == ext_result.first && kernel_prod == ext_result.second,
+           "Dispatched reductions do not agree.");
+    assert(parsed == sz && converted == ext_sample,
+           "Dispatched conversions do not agree.");
+  }
+  ext::reset_isa();
+  cout << "Sanity check succeeded\n";
+
+  cout << "\n--- ALLOCATION BENCHMARKS ---\n";
+  const Extended<int64_t> fill_value(INF::POS);
+  size_t heap_count = 0;
+  const auto heap_time = time_it([&]() {
+    vector<Extended<int64_t>> buffer(sz);
+    fill(buffer.begin(), buffer.end(), fill_value);
+    heap_count = static_cast<size_t>(
+        count(buffer.begin(), buffer.end(), fill_value));
+  });
+  size_t arena_count = 0;
+  const auto arena_time = time_it([&]() {
+    ext::Arena arena;
+    ext::ArenaVector<int64_t> buffer(
+        sz, ext::ArenaAllocator<Extended<int64_t>>(arena));
+    ext::parallel_fill(buffer.data(), sz, fill_value,
+                       thread::hardware_concurrency());
+    arena_count = static_cast<size_t>(
+        count(buffer.begin(), buffer.end(), fill_value));
+  });
+  cout << "Heap zeroed buffer time: " << heap_time << '\n';
+  cout << "Arena uninitialized buffer time: " << arena_time << '\n';
+  assert(heap_count == sz && arena_count == sz,
+         "Allocated buffers do not agree.");
+  cout << "Sanity check succeeded\n";
+
+  cout << "\n--- TIMER BENCHMARKS ---\n";
+  constexpr size_t num_timers = 1000000;
+  using std::chrono::milliseconds;
+  using Deadline = ext::TimerWheel::Deadline;
+  const auto offsets =
+      ext::generate_numbers<int64_t>(num_timers, uniform(7, 1, 600000));
+  size_t map_fired = 0;
+  const auto timer_map_time = time_it([&]() {
+    multimap<milliseconds, function<void()>> timers;
+    vector<decltype(timers)::iterator> handles;
+    handles.reserve(num_timers);
+    for (const auto offset : offsets) {
+      handles.push_back(
+          timers.emplace(milliseconds(offset), [&]() { ++map_fired; }));
+    }
+    for (size_t i = 0; i < num_timers; i += 2) timers.erase(handles[i]);
+    for (auto& timer : timers) timer.second();
+  });
+  size_t wheel_fired = 0;
+  const auto wheel_time = time_it([&]() {
+    ext::TimerWheel wheel;
+    vector<ext::TimerWheel::TimerId> handles;
+    handles.reserve(num_timers);
+    for (const auto offset : offsets) {
+      handles.push_back(wheel.schedule(Deadline(milliseconds(offset)),
+                                       [&]() { ++wheel_fired; }));
+    }
+    for (size_t i = 0; i < num_timers; i += 2) wheel.cancel(handles[i]);
+    wheel.advance(milliseconds(600000));
+  });
+  cout << "Ordered map timers time: " << timer_map_time << '\n';
+  cout << "Timer wheel time: " << wheel_time << '\n';
+  assert(map_fired == num_timers / 2 && wheel_fired == num_timers / 2,
+         "Fired timers do not agree.");
+  cout << "Sanity check succeeded\n";
+
+  cout << "\n--- MAXIMUM FLOW BENCHMARKS ---\n";
+  // Layered network; about one edge in twenty is uncuttable.
+  constexpr size_t layers = 100, width = 400, fan_out = 4;
+  const size_t flow_source = layers * width, flow_sink = flow_source + 1;
+  ext::FlowNetwork<int64_t> network(flow_sink + 1);
+  const size_t num_layer_edges = (layers - 1) * width * fan_out;
+  const auto caps =
+      ext::generate_numbers<int64_t>(num_layer_edges, uniform(11, 1, 1000));
+  const auto heads = ext::generate_numbers<size_t>(
+      num_layer_edges, uniform(12, 0, static_cast<double>(width - 1)));
+  size_t edge = 0;
+  for (size_t v = 0; v < width; ++v) {
+    network.add_edge(flow_source, v, Extended<int64_t>(INF::POS));
+    network.add_edge((layers - 1) * width + v, flow_sink,
+                     Extended<int64_t>(INF::POS));
+  }
+  for (size_t layer = 0; layer + 1 < layers; ++layer) {
+    for (size_t v = 0; v < width; ++v) {
+      for (size_t k = 0; k < fan_out; ++k) {
+        const auto cap = caps[edge];
+        network.add_edge(layer * width + v, (layer + 1) * width + heads[edge],
+                         cap <= 50 ? Extended<int64_t>(INF::POS)
+                                   : Extended<int64_t>(cap));
+        ++edge;
+      }
+    }
+  }
+  cout << "Network of " << network.num_nodes() << " nodes and "
+       << network.num_edges() << " edges\n";
+  Extended<int64_t> dinic_flow, push_flow;
+  const auto dinic_time =
+      time_it([&]() { dinic_flow = network.dinic(flow_source, flow_sink); });
+  const auto push_time = time_it(
+      [&]() { push_flow = network.push_relabel(flow_source, flow_sink); });
+  cout << "Dinic time: " << dinic_time << '\n';
+  cout << "Push-relabel time: " << push_time << '\n';
+  assert(dinic_flow.finite() && dinic_flow == push_flow,
+         "Maximum flows do not agree.");
+  cout << "Sanity check succeeded\n";
+
+  cout << "\n--- ASSIGNMENT BENCHMARKS ---\n";
+  // Dense costs with one entry in ten forbidden.
+  auto assign_config = uniform(13, 1000, 10000);
+  assign_config.inf_density = 0.1;
+  assign_config.neg_inf_share = 0;
+  for (const size_t n : {size_t(1000), size_t(2000), size_t(5000)}) {
+    const auto costs = ext::generate_extended<int64_t>(
+        n * n, assign_config, thread::hardware_concurrency());
+    ext::Assignment<int64_t> by_hungarian, by_auction;
+    const auto hungarian_time =
+        time_it([&]() { by_hungarian = ext::hungarian(costs.data(), n); });
+    const auto auction_time = time_it([&]() {
+      by_auction =
+          ext::auction(costs.data(), n, thread::hardware_concurrency());
+    });
+    cout << "Hungarian time (n = " << n << "): " << hungarian_time << '\n';
+    cout << "Auction time (n = " << n << "): " << auction_time << '\n';
+    assert(by_hungarian.feasible() && by_hungarian.cost == by_auction.cost,
+           "Assignment costs do not agree.");
+  }
+  cout << "Sanity check succeeded\n";
+
+  cout << "\n--- MIN-PLUS CONVOLUTION BENCHMARKS ---\n";
+  // Arbitrary costs with +inf runs at both ends, as in a sparse knapsack.
+  constexpr size_t conv_size = 10000, conv_pad = 1000;
+  const auto conv_values =
+      ext::generate_numbers<int64_t>(2 * conv_size, uniform(17, 0, 1000000));
+  vector<Extended<int64_t>> conv_a(conv_size, Extended<int64_t>(INF::POS));
+  vector<Extended<int64_t>> conv_b(conv_size, Extended<int64_t>(INF::POS));
+  for (size_t i = conv_pad; i + conv_pad < conv_size; ++i) {
+    conv_a[i] = Extended<int64_t>(conv_values[i]);
+    conv_b[i] = Extended<int64_t>(conv_values[conv_size + i]);
+  }
+  vector<Extended<int64_t>> naive_conv, fast_conv;
+  const auto naive_conv_time = time_it([&]() {
+    naive_conv.assign(2 * conv_size - 1, Extended<int64_t>(INF::POS));
+    for (size_t i = 0; i < conv_size; ++i) {
+      if (!conv_a[i].finite()) continue;
+      for (size_t j = 0; j < conv_size; ++j) {
+        if (!conv_b[j].finite()) continue;
+        const auto sum = conv_a[i] + conv_b[j];
+        if (sum < naive_conv[i + j]) naive_conv[i + j] = sum;
+      }
+    }
+  });
+  const auto fast_conv_time = time_it([&]() {
+    fast_conv = ext::minplus_convolve(conv_a.data(), conv_size,
+                                      conv_b.data(), conv_size);
+  });
+  cout << "Naive Extended time: " << naive_conv_time << '\n';
+  cout << "Blocked kernel time: " << fast_conv_time << '\n';
+  assert(naive_conv == fast_conv, "Convolutions do not agree.");
+  // A convex item cost curve against the arbitrary one.
+  for (size_t i = 0; i < conv_size; ++i) {
+    const auto offset = static_cast<int64_t>(i) - int64_t(conv_size / 2);
+    conv_b[i] = Extended<int64_t>(offset * offset);
+  }
+  const auto smawk_time = time_it([&]() {
+    fast_conv = ext::minplus_convolve(conv_a.data(), conv_size,
+                                      conv_b.data(), conv_size);
+  });
+  cout << "SMAWK time: " << smawk_time << '\n';
+  for (size_t k = 0; k < fast_conv.size(); k += 997) {
+    Extended<int64_t> best(INF::POS);
+    for (size_t i = conv_pad; i + conv_pad < conv_size; ++i) {
+      if (k >= i && k - i < conv_size) {
+        best = std::min(best, conv_a[i] + conv_b[k - i]);
+      }
+    }
+    assert(best == fast_conv[k], "SMAWK convolution disagrees.");
+  }
+  cout << "Sanity check succeeded\n";
+
+  cout << "\n--- CONFORMANCE BENCHMARKS ---\n";
+  const auto compound = [](ext::Op op, auto& lhs, const auto& rhs) {
+    ext::apply(op, lhs, rhs);
+  };
+  ext::ConformanceReport signed_report, unsigned_report;
+  const auto conformance_time = time_it([&]() {
+    signed_report = ext::check_conformance<int8_t>(
+        compound, thread::hardware_concurrency());
+    unsigned_report = ext::check_conformance<uint8_t>(
+        compound, thread::hardware_concurrency());
+  });
+  cout << "Cases checked: " << signed_report.checked + unsigned_report.checked
+       << ", undefined and skipped: "
+       << signed_report.skipped + unsigned_report.skipped << '\n';
+  cout << "Exhaustive check time: " << conformance_time << '\n';
+  assert(!signed_report.mismatches && !unsigned_report.mismatches,
+         "Compound operators do not conform.");
+  cout << "Sanity check succeeded\n";
+
+  cout << "\n--- INSTRUMENTATION BENCHMARKS ---\n";
+  // Compare this section between make release and make instrumented.
+  cout << "Operation counters "
+       << (ext::INSTRUMENTED ? "enabled" : "disabled, see make instrumented")
+       << '\n';
+  ext::reset_counts();
+  pair<Extended<int64_t>, Extended<int64_t>> counted_result;
+  const auto counted_time =
+      time_it([&]() { counted_result = operate(ext_sample); });
+  const auto counts = ext::collect_counts();
+  // The hook alone, called directly so it is timed in either build.
+  const auto hook_time = time_it([]() {
+    for (size_t i = 0; i < 2 * sz; ++i) {
+      ext::detail::count_op(ext::Op::ADD, 0, 0);
+    }
+  });
+  cout << "Extended time: " << counted_time << '\n';
+  cout << "Counter hook time for " << 2 * sz << " calls: " << hook_time
+       << '\n';
+  cout << ext::format_counts(counts, ext::CountFormat::TEXT);
+  assert(counted_result == ext_result, "Counted results do not agree.");
+  assert(counts.total() == (ext::INSTRUMENTED ? 2 * sz : 0),
+         "Operation counts do not agree.");
+  ext::reset_counts();
+  cout << "Sanity check succeeded\n";
+
+  cout << "\n--- WORKLOAD BENCHMARKS ---\n";
+  const size_t workers = thread::hardware_concurrency();
+  vector<int64_t> workload_serial, workload_parallel;
+  const auto serial_gen_time = time_it([&]() {
+    workload_serial =
+        ext::generate_numbers<int64_t>(sz, uniform(1, -1000, 1000));
+  });
+  const auto parallel_gen_time = time_it([&]() {
+    workload_parallel =
+        ext::generate_numbers<int64_t>(sz, uniform(1, -1000, 1000), workers);
+  });
+  cout << "Serial generation time: " << serial_gen_time << '\n';
+  cout << "Parallel generation time: " << parallel_gen_time << '\n';
+  assert(workload_serial == workload_parallel && workload_serial == num_sample,
+         "Generated workloads do not agree.");
+  // Sums over +inf at several densities, scattered and in runs, so the
+  // infinite paths are measured too.
+  const pair<double, double> shapes[] = {
+      {0, 1}, {0.01, 1}, {0.01, 1024}, {0.5, 1}, {0.5, 1024}};
+  for (const auto& shape : shapes) {
+    auto config = uniform(19, -1000, 1000);
+    config.inf_density = shape.first;
+    config.inf_run_length = shape.second;
+    config.neg_inf_share = 0;
+    const auto nums = ext::generate_extended<int64_t>(sz, config, workers);
+    Extended<int64_t> scalar_sum, kernel_sum;
+    const auto scalar_sum_time = time_it([&]() {
+      scalar_sum = accumulate(nums.begin(), nums.end(), Extended<int64_t>());
+    });
+    const auto kernel_sum_time = time_it(
+        [&]() { kernel_sum = ext::kernels<int64_t>().sum(nums.data(), sz); });
+    cout << "Infinity density " << shape.first << ", run length "
+         << shape.second << ": scalar time " << scalar_sum_time
+         << ", kernel time " << kernel_sum_time << '\n';
+    assert(scalar_sum == kernel_sum, "Workload sums do not agree.");
+  }
+  cout << "Sanity check succeeded\n";
 }
 
-template <typename T>
-vector<T> random_numbers(size_t sz, T min_val, T max_val) {
-  static const auto seed =
-      high_resolution_clock::now().time_since_epoch().count();
-  static default_random_engine gen(seed);
-  static uniform_int_distribution<T> distr(min_val, max_val);
-  vector<T> rand_nums(sz);
-  generate(rand_nums.begin(), rand_nums.end(), []() { return distr(gen); });
-  return rand_nums;
+ext::WorkloadConfig uniform(uint64_t seed, double min_val, double max_val) {
+  ext::WorkloadConfig config;
+  config.seed = seed;
+  config.min = min_val;
+  config.max = max_val;
+  return config;
 }
 
 template <typename T>
@@ -145,3 +668,36 @@ pair<T, T> operate(const vector<T>& numbers) {
                                [](T x, T y) { return x * y; });
   return make_pair(sum, prod);
 }
+
+template <typename Func>
+int64_t time_it(Func func) {
+  const auto begin = high_resolution_clock::now();
+  func();
+  const auto end = high_resolution_clock::now();
+  return duration_cast<dur_t>(end - begin).count();
+}
+
+void print_counters(const PerfCounters& counters, const uint64_t* num_counts,
+                    const uint64_t* ext_counts, size_t sz) {
+  if (!counters.available()) {
+    cout << "Hardware counters unavailable, reporting wall clock only\n";
+    return;
+  }
+  const auto flags = cout.flags();
+  const auto precision = cout.precision();
+  cout << "Per element" << setw(18) << "primitive" << setw(12) << "extended"
+       << '\n'
+       << fixed << setprecision(3);
+  for (size_t e = 0; e < PerfCounters::NUM_EVENTS; ++e) {
+    const auto event = static_cast<PerfCounters::Event>(e);
+    if (!counters.available(event)) continue;
+    cout << "  " << left << setw(16) << PerfCounters::name(event)
+         << right << setw(11)
+         << static_cast<double>(num_counts[e]) / static_cast<double>(sz)
+         << setw(12)
+         << static_cast<double>(ext_counts[e]) / static_cast<double>(sz)
+         << '\n';
+  }
+  cout.flags(flags);
+  cout.precision(precision);
+}
@@ -0,0 +1,56 @@
+/*
+Array kernels that broadcast a finite scalar over extended numbers.
+The scalar is a plain T, so every element takes the single-flag path of the
+mixed Extended<T> op T operators.
+
+Copyright 2020. Siwei Wang.
+*/
+#pragma once
+#include <cstddef>
+#include "extended.h"
+
+namespace ext {
+/**
+ * Multiplies every element by factor in place.
+ * @param nums Array of sz elements.
+ * @param sz Number of elements.
+ * @param factor The finite scale.
+ */
+template <typename T>
+void scale(Extended<T>* nums, size_t sz,
+           typename Extended<T>::value_type factor) noexcept {
+  for (size_t i = 0; i < sz; ++i) nums[i] *= factor;
+}
+
+/**
+ * Adds delta to every element in place.
+ * @param nums Array of sz elements.
+ * @param sz Number of elements.
+ * @param delta The finite offset.
+ */
+template <typename T>
+void offset(Extended<T>* nums, size_t sz,
+            typename Extended<T>::value_type delta) noexcept {
+  for (size_t i = 0; i < sz; ++i) nums[i] += delta;
+}
+
+/**
+ * Computes ys[i] += alpha * xs[i].
+ * THROWS: infinite_error on opposite infinities, as operator+= does.
+ * @param alpha The finite scale.
+ * @param xs Array of sz elements.
+ * @param ys Array of sz elements updated in place.
+ * @param sz Number of elements.
+ */
+template <typename T>
+void axpy(typename Extended<T>::value_type alpha, const Extended<T>* xs,
+          Extended<T>* ys, size_t sz) {
+  for (size_t i = 0; i < sz; ++i) {
+    if (xs[i].finite() && ys[i].finite()) {
+      ys[i] = static_cast<T>(ys[i].raw_value() + alpha * xs[i].raw_value());
+    } else {
+      ys[i] += xs[i] * alpha;
+    }
+  }
+}
+}  // namespace ext
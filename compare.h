@@ -0,0 +1,256 @@
+/*
+Branch-free batch comparison kernels for extended numbers.
+Each kernel writes a packed bitmask where bit i holds the comparison of
+element i, matching operator<, operator<=, operator==, and operator>.
+
+Copyright 2020. Siwei Wang.
+*/
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include "extended.h"
+
+namespace ext {
+/**
+ * @param sz Number of compared elements.
+ * @returns Number of 64-bit words in a bitmask for sz elements.
+ */
+constexpr size_t mask_words(size_t sz) noexcept { return (sz + 63) / 64; }
+
+namespace detail {
+// Multiplier moving the low bit of each byte of a word into the top byte.
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+static constexpr uint64_t GATHER_BITS = 0x8040201008040201ULL;
+#else
+static constexpr uint64_t GATHER_BITS = 0x0102040810204080ULL;
+#endif
+
+/**
+ * Branch-free equivalent of operator< on unpacked operands.
+ * Infinite operands are decided by their flags alone.
+ */
+template <typename T>
+bool less(int flag_1, T val_1, int flag_2, T val_2) noexcept {
+  return (flag_1 < flag_2) | ((flag_1 == flag_2) & (flag_1 == 0) &
+                              std::less<T>{}(val_1, val_2));
+}
+
+/**
+ * Branch-free equivalent of operator== on unpacked operands.
+ */
+template <typename T>
+bool equal(int flag_1, T val_1, int flag_2, T val_2) noexcept {
+  return (flag_1 == flag_2) &
+         ((flag_1 != 0) | std::equal_to<T>{}(val_1, val_2));
+}
+
+/**
+ * Evaluates pred on [0, sz) and packs the results into mask.
+ * Results are staged as bytes so the predicate loop stays vectorizable.
+ * @param sz Number of elements.
+ * @param mask Output of at least mask_words(sz) words.
+ * @param pred Callable mapping an index to bool.
+ */
+template <typename Pred>
+void pack(size_t sz, uint64_t* mask, Pred pred) {
+  const size_t full = sz / 64;
+  unsigned char bytes[64];
+  for (size_t w = 0; w < full; ++w) {
+    const size_t base = w * 64;
+    for (size_t b = 0; b < 64; ++b) {
+      bytes[b] = static_cast<unsigned char>(pred(base + b));
+    }
+    uint64_t word = 0;
+    for (size_t k = 0; k < 8; ++k) {
+      uint64_t eight;
+      std::memcpy(&eight, bytes + 8 * k, sizeof(eight));
+      word |= ((eight * GATHER_BITS) >> 56) << (8 * k);
+    }
+    mask[w] = word;
+  }
+  if (sz % 64) {
+    uint64_t word = 0;
+    for (size_t i = full * 64; i < sz; ++i) {
+      word |= static_cast<uint64_t>(pred(i)) << (i % 64);
+    }
+    mask[full] = word;
+  }
+}
+}  // namespace detail
+
+// ARRAY AGAINST SCALAR
+// The flag of the scalar is resolved once so each loop has a single shape.
+// Against a finite scalar, flag < (value < scalar) is nums[i] < scalar:
+// -inf is below both 0 and 1, +inf below neither, and a finite flag of 0
+// leaves the value comparison. One compare replaces three.
+
+/**
+ * Sets bit i of mask to nums[i] < rhs.
+ * @param nums The array of sz elements.
+ * @param sz Number of elements.
+ * @param rhs The scalar to compare against.
+ * @param mask Output of at least mask_words(sz) words.
+ */
+template <typename T>
+void compare_lt(const Extended<T>* nums, size_t sz, const Extended<T>& rhs,
+                uint64_t* mask) {
+  const int flag = rhs.inf_sign();
+  if (flag) {
+    detail::pack(sz, mask, [=](size_t i) { return nums[i].inf_sign() < flag; });
+    return;
+  }
+  const T val = rhs.raw_value();
+  detail::pack(sz, mask, [=](size_t i) {
+    return nums[i].inf_sign() <
+           static_cast<int>(std::less<T>{}(nums[i].raw_value(), val));
+  });
+}
+
+/**
+ * Sets bit i of mask to nums[i] > rhs.
+ */
+template <typename T>
+void compare_gt(const Extended<T>* nums, size_t sz, const Extended<T>& rhs,
+                uint64_t* mask) {
+  const int flag = rhs.inf_sign();
+  if (flag) {
+    detail::pack(sz, mask, [=](size_t i) { return nums[i].inf_sign() > flag; });
+    return;
+  }
+  const T val = rhs.raw_value();
+  detail::pack(sz, mask, [=](size_t i) {
+    return nums[i].inf_sign() >
+           -static_cast<int>(std::less<T>{}(val, nums[i].raw_value()));
+  });
+}
+
+/**
+ * Sets bit i of mask to nums[i] <= rhs.
+ */
+template <typename T>
+void compare_le(const Extended<T>* nums, size_t sz, const Extended<T>& rhs,
+                uint64_t* mask) {
+  const int flag = rhs.inf_sign();
+  if (flag) {
+    detail::pack(sz, mask,
+                 [=](size_t i) { return nums[i].inf_sign() <= flag; });
+    return;
+  }
+  const T val = rhs.raw_value();
+  detail::pack(sz, mask, [=](size_t i) {
+    return nums[i].inf_sign() <
+           static_cast<int>(!std::less<T>{}(val, nums[i].raw_value()));
+  });
+}
+
+/**
+ * Sets bit i of mask to nums[i] == rhs.
+ */
+template <typename T>
+void compare_eq(const Extended<T>* nums, size_t sz, const Extended<T>& rhs,
+                uint64_t* mask) {
+  const int flag = rhs.inf_sign();
+  if (flag) {
+    detail::pack(sz, mask,
+                 [=](size_t i) { return nums[i].inf_sign() == flag; });
+    return;
+  }
+  const T val = rhs.raw_value();
+  detail::pack(sz, mask, [=](size_t i) {
+    return (nums[i].inf_sign() == 0) &
+           std::equal_to<T>{}(nums[i].raw_value(), val);
+  });
+}
+
+// ARRAY AGAINST ARRAY
+
+/**
+ * Sets bit i of mask to lhs[i] < rhs[i].
+ * @param lhs The left array of sz elements.
+ * @param rhs The right array of sz elements.
+ * @param sz Number of elements.
+ * @param mask Output of at least mask_words(sz) words.
+ */
+template <typename T>
+void compare_lt(const Extended<T>* lhs, const Extended<T>* rhs, size_t sz,
+                uint64_t* mask) {
+  detail::pack(sz, mask, [=](size_t i) {
+    return detail::less(lhs[i].inf_sign(), lhs[i].raw_value(),
+                        rhs[i].inf_sign(), rhs[i].raw_value());
+  });
+}
+
+/**
+ * Sets bit i of mask to lhs[i] <= rhs[i].
+ */
+template <typename T>
+void compare_le(const Extended<T>* lhs, const Extended<T>* rhs, size_t sz,
+                uint64_t* mask) {
+  detail::pack(sz, mask, [=](size_t i) {
+    return !detail::less(rhs[i].inf_sign(), rhs[i].raw_value(),
+                         lhs[i].inf_sign(), lhs[i].raw_value());
+  });
+}
+
+/**
+ * Sets bit i of mask to lhs[i] == rhs[i].
+ */
+template <typename T>
+void compare_eq(const Extended<T>* lhs, const Extended<T>* rhs, size_t sz,
+                uint64_t* mask) {
+  detail::pack(sz, mask, [=](size_t i) {
+    return detail::equal(lhs[i].inf_sign(), lhs[i].raw_value(),
+                         rhs[i].inf_sign(), rhs[i].raw_value());
+  });
+}
+
+/**
+ * Sets bit i of mask to lhs[i] > rhs[i].
+ */
+template <typename T>
+void compare_gt(const Extended<T>* lhs, const Extended<T>* rhs, size_t sz,
+                uint64_t* mask) {
+  detail::pack(sz, mask, [=](size_t i) {
+    return detail::less(rhs[i].inf_sign(), rhs[i].raw_value(),
+                        lhs[i].inf_sign(), lhs[i].raw_value());
+  });
+}
+
+// SELECTION VECTORS
+
+/**
+ * Converts a bitmask into the ascending indices of its set bits.
+ * @param mask Bitmask over sz elements.
+ * @param sz Number of elements covered by mask.
+ * @param selection Output of at least sz indices.
+ * @returns Number of indices written.
+ */
+inline size_t to_selection(const uint64_t* mask, size_t sz,
+                           uint32_t* selection) noexcept {
+  size_t count = 0;
+  for (size_t w = 0; w < mask_words(sz); ++w) {
+    uint64_t word = mask[w];
+    while (word) {
+      const auto bit = static_cast<size_t>(__builtin_ctzll(word));
+      selection[count++] = static_cast<uint32_t>(w * 64 + bit);
+      word &= word - 1;
+    }
+  }
+  return count;
+}
+
+/**
+ * @param mask Bitmask over sz elements.
+ * @param sz Number of elements covered by mask.
+ * @returns Number of set bits.
+ */
+inline size_t count_selected(const uint64_t* mask, size_t sz) noexcept {
+  size_t count = 0;
+  for (size_t w = 0; w < mask_words(sz); ++w) {
+    count += static_cast<size_t>(__builtin_popcountll(mask[w]));
+  }
+  return count;
+}
+}  // namespace ext
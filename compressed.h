@@ -0,0 +1,212 @@
+/*
+Compressed column of mostly-finite extended integers. Each block stores its
+finite values as bit-packed offsets from the block minimum (frame of
+reference), and infinite elements are kept in a sparse sorted list.
+
+Copyright 2020. Siwei Wang.
+*/
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+#include "extended.h"
+#include "infinite_error.h"
+
+namespace ext {
+template <typename T>
+class CompressedColumn {
+  static_assert(std::is_integral_v<T>, "Compression requires integers.");
+
+ public:
+  // Elements per block. Random access unpacks at most one value.
+  static constexpr size_t BLOCK = 1024;
+
+ private:
+  using U = std::make_unsigned_t<T>;
+
+  struct Block {
+    T base;
+    uint32_t width;
+    size_t word_offset;
+    // Range of this block within m_inf_idx and m_inf_sign.
+    size_t inf_begin;
+    size_t inf_end;
+  };
+
+  std::vector<uint64_t> m_words;
+  std::vector<Block> m_blocks;
+  std::vector<size_t> m_inf_idx;
+  std::vector<int8_t> m_inf_sign;
+  size_t m_size;
+
+  /**
+   * @returns Offset idx of a block packed at the given width.
+   */
+  static uint64_t unpack(const uint64_t* words, uint32_t width, size_t idx) {
+    if (width == 0) return 0;
+    const size_t bit = idx * width;
+    const size_t shift = bit % 64;
+    uint64_t delta = words[bit / 64] >> shift;
+    if (shift + width > 64) delta |= words[bit / 64 + 1] << (64 - shift);
+    return width == 64 ? delta : delta & ((uint64_t(1) << width) - 1);
+  }
+
+  static T rebase(T base, uint64_t delta) noexcept {
+    return static_cast<T>(static_cast<U>(static_cast<U>(base) + delta));
+  }
+
+  size_t block_count(size_t block_idx) const noexcept {
+    return std::min(BLOCK, m_size - block_idx * BLOCK);
+  }
+
+ public:
+  /**
+   * Compresses sz elements.
+   * @param nums Array of sz elements.
+   * @param sz Number of elements.
+   */
+  CompressedColumn(const Extended<T>* nums, size_t sz) : m_size(sz) {
+    for (size_t begin = 0; begin < sz; begin += BLOCK) {
+      const size_t end = std::min(sz, begin + BLOCK);
+      Block blk{T(0), 0, m_words.size(), m_inf_idx.size(), 0};
+      bool any_finite = false;
+      T high = T(0);
+      for (size_t i = begin; i < end; ++i) {
+        const int sign = nums[i].inf_sign();
+        if (sign) {
+          m_inf_idx.push_back(i);
+          m_inf_sign.push_back(static_cast<int8_t>(sign));
+          continue;
+        }
+        const T val = nums[i].raw_value();
+        if (!any_finite || val < blk.base) blk.base = val;
+        if (!any_finite || high < val) high = val;
+        any_finite = true;
+      }
+      blk.inf_end = m_inf_idx.size();
+      uint64_t range = static_cast<U>(static_cast<U>(high) -
+                                      static_cast<U>(blk.base));
+      while (range) {
+        ++blk.width;
+        range >>= 1;
+      }
+      m_words.resize(m_words.size() + (blk.width * (end - begin) + 63) / 64);
+      uint64_t* words = m_words.data() + blk.word_offset;
+      for (size_t i = begin; blk.width && i < end; ++i) {
+        if (!nums[i].finite()) continue;
+        const uint64_t delta = static_cast<U>(
+            static_cast<U>(nums[i].raw_value()) - static_cast<U>(blk.base));
+        const size_t bit = (i - begin) * blk.width;
+        const size_t shift = bit % 64;
+        words[bit / 64] |= delta << shift;
+        if (shift + blk.width > 64) {
+          words[bit / 64 + 1] |= delta >> (64 - shift);
+        }
+      }
+      m_blocks.push_back(blk);
+    }
+  }
+
+  size_t size() const noexcept { return m_size; }
+
+  size_t num_blocks() const noexcept { return m_blocks.size(); }
+
+  /**
+   * @returns Approximate heap footprint of the compressed data in bytes.
+   */
+  size_t bytes() const noexcept {
+    return m_words.size() * sizeof(uint64_t) +
+           m_blocks.size() * sizeof(Block) +
+           m_inf_idx.size() * (sizeof(size_t) + sizeof(int8_t));
+  }
+
+  /**
+   * Random access that unpacks only the requested element.
+   * @param idx Index below size().
+   * @returns Element idx.
+   */
+  Extended<T> operator[](size_t idx) const {
+    const Block& blk = m_blocks[idx / BLOCK];
+    const auto first =
+        m_inf_idx.begin() + static_cast<std::ptrdiff_t>(blk.inf_begin);
+    const auto last =
+        m_inf_idx.begin() + static_cast<std::ptrdiff_t>(blk.inf_end);
+    const auto found = std::lower_bound(first, last, idx);
+    if (found != last && *found == idx) {
+      const auto pos = static_cast<size_t>(found - m_inf_idx.begin());
+      return Extended<T>(m_inf_sign[pos] > 0 ? INF::POS : INF::NEG);
+    }
+    const uint64_t delta =
+        unpack(m_words.data() + blk.word_offset, blk.width, idx % BLOCK);
+    return Extended<T>(rebase(blk.base, delta));
+  }
+
+  /**
+   * Unpacks the stored values of a block. Infinite slots hold the base.
+   * @param block_idx Index of the block.
+   * @param out Output of at least BLOCK values.
+   * @returns Number of values written.
+   */
+  size_t decompress_block(size_t block_idx, T* out) const {
+    const Block& blk = m_blocks[block_idx];
+    const size_t count = block_count(block_idx);
+    const uint64_t* words = m_words.data() + blk.word_offset;
+    for (size_t i = 0; i < count; ++i) {
+      out[i] = rebase(blk.base, unpack(words, blk.width, i));
+    }
+    return count;
+  }
+
+  /**
+   * @returns Every element in a new uncompressed array.
+   */
+  std::vector<Extended<T>> decompress() const {
+    std::vector<Extended<T>> out(m_size);
+    T buffer[BLOCK];
+    for (size_t b = 0; b < m_blocks.size(); ++b) {
+      const size_t count = decompress_block(b, buffer);
+      for (size_t i = 0; i < count; ++i) {
+        out[b * BLOCK + i] = Extended<T>(buffer[i]);
+      }
+    }
+    for (size_t k = 0; k < m_inf_idx.size(); ++k) {
+      const INF inf = m_inf_sign[k] > 0 ? INF::POS : INF::NEG;
+      out[m_inf_idx[k]] = Extended<T>(inf);
+    }
+    return out;
+  }
+
+  /**
+   * Sum with the rules of operator+=. Infinities are resolved from the
+   * sparse list alone; otherwise blocks are summed as base * count plus
+   * their unpacked offsets, with T's wrapping arithmetic.
+   * THROWS: infinite_error if the column holds both +inf and -inf.
+   * @returns The sum of all elements.
+   */
+  Extended<T> sum() const {
+    const bool pos_inf = std::find(m_inf_sign.begin(), m_inf_sign.end(),
+                                   int8_t(1)) != m_inf_sign.end();
+    const bool neg_inf = std::find(m_inf_sign.begin(), m_inf_sign.end(),
+                                   int8_t(-1)) != m_inf_sign.end();
+    if (pos_inf && neg_inf)
+      throw infinite_error("Indeterminate form: +inf + -inf");
+    if (pos_inf) return Extended<T>(INF::POS);
+    if (neg_inf) return Extended<T>(INF::NEG);
+    uint64_t total = 0;
+    for (size_t b = 0; b < m_blocks.size(); ++b) {
+      const Block& blk = m_blocks[b];
+      const size_t count = block_count(b);
+      const uint64_t* words = m_words.data() + blk.word_offset;
+      uint64_t offsets = 0;
+      for (size_t i = 0; i < count; ++i) {
+        offsets += unpack(words, blk.width, i);
+      }
+      total += static_cast<U>(blk.base) * static_cast<uint64_t>(count) +
+               offsets;
+    }
+    return Extended<T>(static_cast<T>(static_cast<U>(total)));
+  }
+};
+}  // namespace ext
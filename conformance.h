@@ -0,0 +1,251 @@
+/*
+Exhaustive conformance checking of Extended<T> arithmetic for small integer
+types. Every pair of finite values and infinities goes through each compound
+operator and is compared with a reference model written from the rules,
+not from the implementation. The model is the gate for any faster
+arithmetic core, such as a branchless, vectorized or repacked one.
+
+Copyright 2020. Siwei Wang.
+*/
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+#include "extended.h"
+#include "infinite_error.h"
+#include "instrument.h"
+
+namespace ext {
+/**
+ * What the model says lhs op= rhs must do.
+ */
+template <typename T>
+struct Outcome {
+  // Undefined behaviour of the underlying type, which no kernel is held to.
+  bool undefined = false;
+  // Throws infinite_error and leaves lhs unchanged.
+  bool throws = false;
+  // New value of lhs otherwise.
+  Extended<T> value;
+};
+
+/**
+ * Reference model of today's compound operators. Finite results are
+ * computed in int64_t after the usual promotions and converted back to T.
+ * Infinite operands follow the sign rules, with finite zero times an
+ * infinity equal to zero, and a finite number over an infinity equal to
+ * zero.
+ * REQUIRES: T is an integer type no wider than 32 bits.
+ */
+template <typename T>
+Outcome<T> reference(Op op, const Extended<T>& lhs, const Extended<T>& rhs) {
+  static_assert(std::is_integral_v<T> && sizeof(T) <= 4,
+                "The reference model covers small integer types.");
+  using Promoted = decltype(+T(0));
+  Outcome<T> out;
+  const int sign_l = lhs.finite() ? (lhs.raw_value() > T(0)) -
+                                        (lhs.raw_value() < T(0))
+                                  : lhs.inf_sign();
+  const int sign_r = rhs.finite() ? (rhs.raw_value() > T(0)) -
+                                        (rhs.raw_value() < T(0))
+                                  : rhs.inf_sign();
+  const auto infinite = [](int sign) {
+    return Extended<T>(sign > 0 ? INF::POS : INF::NEG);
+  };
+  const bool both = lhs.finite() && rhs.finite();
+  const auto x = static_cast<int64_t>(lhs.raw_value());
+  const auto y = static_cast<int64_t>(rhs.raw_value());
+  const auto wrap = [](int64_t result) {
+    return Extended<T>(static_cast<T>(result));
+  };
+  switch (op) {
+    case Op::ADD:
+    case Op::SUB: {
+      const int inf_r = op == Op::ADD ? rhs.inf_sign() : -rhs.inf_sign();
+      if (both) {
+        out.value = wrap(op == Op::ADD ? x + y : x - y);
+      } else if (!lhs.finite() && !rhs.finite() && lhs.inf_sign() != inf_r) {
+        out.throws = true;
+      } else {
+        out.value = infinite(lhs.finite() ? inf_r : lhs.inf_sign());
+      }
+      break;
+    }
+    case Op::MUL:
+      if (both) {
+        out.value = wrap(x * y);
+      } else if (sign_l == 0 || sign_r == 0) {
+        out.value = Extended<T>(T(0));
+      } else {
+        out.value = infinite(sign_l * sign_r);
+      }
+      break;
+    case Op::DIV:
+      if (rhs.finite() && y == 0) {
+        out.throws = true;
+      } else if (both) {
+        out.value = wrap(x / y);
+      } else if (!rhs.finite()) {
+        if (lhs.finite()) {
+          out.value = Extended<T>(T(0));
+        } else {
+          out.throws = true;
+        }
+      } else {
+        out.value = infinite(sign_l * sign_r);
+      }
+      break;
+    default: {
+      // Modulo, bitwise and shifts require finite operands.
+      if (!both) {
+        out.throws = true;
+        break;
+      }
+      constexpr int64_t bits = std::numeric_limits<Promoted>::digits +
+                               std::numeric_limits<Promoted>::is_signed;
+      if (op == Op::MOD) {
+        out.undefined = y == 0;
+        if (!out.undefined) out.value = wrap(x % y);
+      } else if (op == Op::AND) {
+        out.value = wrap(x & y);
+      } else if (op == Op::OR) {
+        out.value = wrap(x | y);
+      } else if (op == Op::XOR) {
+        out.value = wrap(x ^ y);
+      } else if (y < 0 || y >= bits) {
+        out.undefined = true;
+      } else if (op == Op::SHL) {
+        // A negative or overflowing promoted left shift is undefined.
+        out.undefined =
+            x < 0 || (x << y) > int64_t(std::numeric_limits<Promoted>::max());
+        if (!out.undefined) out.value = wrap(x << y);
+      } else {
+        out.value = wrap(x >> y);
+      }
+    }
+  }
+  return out;
+}
+
+/**
+ * Applies lhs op= rhs with the compound operators of Extended<T>.
+ */
+template <typename T>
+void apply(Op op, Extended<T>& lhs, const Extended<T>& rhs) {
+  switch (op) {
+    case Op::ADD: lhs += rhs; break;
+    case Op::SUB: lhs -= rhs; break;
+    case Op::MUL: lhs *= rhs; break;
+    case Op::DIV: lhs /= rhs; break;
+    case Op::MOD: lhs %= rhs; break;
+    case Op::AND: lhs &= rhs; break;
+    case Op::OR: lhs |= rhs; break;
+    case Op::XOR: lhs ^= rhs; break;
+    case Op::SHL: lhs <<= rhs; break;
+    case Op::SHR: lhs >>= rhs; break;
+    default: throw infinite_error("Internal error: invalid operator.");
+  }
+}
+
+struct ConformanceReport {
+  size_t checked = 0;
+  // Cases with undefined behaviour in T, not checked.
+  size_t skipped = 0;
+  size_t mismatches = 0;
+  // Description of the first mismatch in enumeration order, if any.
+  std::string first_mismatch;
+};
+
+namespace detail {
+template <typename T>
+std::string describe(const Extended<T>& num) {
+  if (!num.finite()) return num.inf_sign() > 0 ? "+inf" : "-inf";
+  // Widen, so that 8-bit types print as numbers rather than characters.
+  return std::to_string(static_cast<int64_t>(num.raw_value()));
+}
+}  // namespace detail
+
+/**
+ * Runs every pair of T values and infinities through kernel for every Op,
+ * and compares the result, or the throw, with reference(). Pairs are split
+ * by left operand across threads.
+ * REQUIRES: T is an 8-bit integer type, so enumeration is exhaustive.
+ * @param kernel Callable as kernel(op, lhs, rhs), updating lhs as op=.
+ * @param threads Number of worker threads.
+ * @returns Counts and the first mismatch.
+ */
+template <typename T, typename Kernel>
+ConformanceReport check_conformance(const Kernel& kernel, size_t threads = 1) {
+  static_assert(std::is_integral_v<T> && sizeof(T) == 1,
+                "Exhaustive checking covers 8-bit types.");
+  std::vector<Extended<T>> values;
+  for (int v = std::numeric_limits<T>::min();
+       v <= std::numeric_limits<T>::max(); ++v) {
+    values.emplace_back(static_cast<T>(v));
+  }
+  values.emplace_back(INF::POS);
+  values.emplace_back(INF::NEG);
+  const size_t sz = values.size();
+  threads = std::max<size_t>(1, std::min(threads, sz));
+  const size_t per_thread = (sz + threads - 1) / threads;
+  std::vector<ConformanceReport> reports(threads);
+  // Index of each thread's first mismatch, to keep enumeration order.
+  std::vector<size_t> first_at(threads, std::numeric_limits<size_t>::max());
+  const auto work = [&](size_t t) {
+    ConformanceReport& report = reports[t];
+    const size_t end = std::min(sz, (t + 1) * per_thread);
+    for (size_t i = std::min(sz, t * per_thread); i < end; ++i) {
+      for (size_t j = 0; j < sz; ++j) {
+        for (int o = 0; o < static_cast<int>(Op::NUM_OPS); ++o) {
+          const auto op = static_cast<Op>(o);
+          const Outcome<T> want = reference(op, values[i], values[j]);
+          if (want.undefined) {
+            ++report.skipped;
+            continue;
+          }
+          ++report.checked;
+          Extended<T> got = values[i];
+          bool threw = false;
+          try {
+            kernel(op, got, values[j]);
+          } catch (const infinite_error&) {
+            threw = true;
+          }
+          const Extended<T>& expected = want.throws ? values[i] : want.value;
+          if (threw == want.throws && got == expected) continue;
+          if (!report.mismatches++) {
+            first_at[t] = i;
+            report.first_mismatch =
+                detail::describe(values[i]) + ' ' + op_name(op) + ' ' +
+                detail::describe(values[j]) + ": expected " +
+                (want.throws ? "throw" : detail::describe(want.value)) +
+                ", got " + (threw ? "throw" : detail::describe(got));
+          }
+        }
+      }
+    }
+  };
+  std::vector<std::thread> workers;
+  for (size_t t = 1; t < threads; ++t) workers.emplace_back(work, t);
+  work(0);
+  for (auto& worker : workers) worker.join();
+
+  ConformanceReport total;
+  size_t first = std::numeric_limits<size_t>::max();
+  for (size_t t = 0; t < threads; ++t) {
+    total.checked += reports[t].checked;
+    total.skipped += reports[t].skipped;
+    total.mismatches += reports[t].mismatches;
+    if (first_at[t] < first) {
+      first = first_at[t];
+      total.first_mismatch = reports[t].first_mismatch;
+    }
+  }
+  return total;
+}
+}  // namespace ext
@@ -0,0 +1,55 @@
+/*
+CPU feature detection for runtime dispatch.
+
+Copyright 2020. Siwei Wang.
+*/
+#include "dispatch.h"
+#include <atomic>
+#include <stdexcept>
+
+namespace {
+// Level forced by force_isa, or -1 to use the detected level.
+std::atomic<int> forced_isa{-1};
+}  // namespace
+
+const char* ext::isa_name(Isa isa) noexcept {
+  switch (isa) {
+    case Isa::AVX512:
+      return "avx512";
+    case Isa::AVX2:
+      return "avx2";
+    default:
+      return "sse2";
+  }
+}
+
+ext::Isa ext::detected_isa() noexcept {
+  static const Isa detected = []() {
+#if EXT_DISPATCH_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f") &&
+        __builtin_cpu_supports("avx512dq"))
+      return Isa::AVX512;
+    if (__builtin_cpu_supports("avx2")) return Isa::AVX2;
+#endif
+    return Isa::SSE2;
+  }();
+  return detected;
+}
+
+ext::Isa ext::active_isa() noexcept {
+  const int forced = forced_isa.load(std::memory_order_relaxed);
+  return forced < 0 ? detected_isa() : static_cast<Isa>(forced);
+}
+
+void ext::force_isa(Isa isa) {
+  if (static_cast<int>(isa) > static_cast<int>(detected_isa())) {
+    throw std::invalid_argument(
+        "Dispatch error: instruction set not supported by this CPU.");
+  }
+  forced_isa.store(static_cast<int>(isa), std::memory_order_relaxed);
+}
+
+void ext::reset_isa() noexcept {
+  forced_isa.store(-1, std::memory_order_relaxed);
+}
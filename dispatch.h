@@ -0,0 +1,258 @@
+/*
+Runtime CPU dispatch for the bulk kernels. Every kernel is compiled once per
+instruction set level and the table for the level detected at startup is
+selected, so one portable binary still runs AVX2 or AVX-512 code where the
+CPU supports it.
+
+Copyright 2020. Siwei Wang.
+*/
+#pragma once
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <system_error>
+#include "compare.h"
+#include "extended.h"
+#include "infinite_error.h"
+#include "view.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define EXT_DISPATCH_X86 1
+#else
+#define EXT_DISPATCH_X86 0
+#endif
+
+namespace ext {
+/**
+ * Instruction set levels in increasing order. SSE2 is the x86-64 baseline
+ * and the only level used on other architectures.
+ */
+enum class Isa : int { SSE2 = 0, AVX2 = 1, AVX512 = 2 };
+
+/**
+ * @returns The lower case name of isa.
+ */
+const char* isa_name(Isa isa) noexcept;
+
+/**
+ * @returns The highest level supported by this CPU, detected once.
+ */
+Isa detected_isa() noexcept;
+
+/**
+ * @returns The level the kernels currently dispatch to.
+ */
+Isa active_isa() noexcept;
+
+/**
+ * Dispatches every kernel to isa until reset_isa() is called.
+ * THROWS: std::invalid_argument if this CPU does not support isa.
+ */
+void force_isa(Isa isa);
+
+/**
+ * Returns dispatch to the detected level.
+ */
+void reset_isa() noexcept;
+
+/**
+ * Bulk kernels bound to one instruction set level.
+ */
+template <typename T>
+struct Kernels {
+  // Sum with the rules of operator+=.
+  Extended<T> (*sum)(const Extended<T>* nums, size_t sz);
+  // Product with the rules of operator*=.
+  Extended<T> (*product)(const Extended<T>* nums, size_t sz);
+  // Bitmask of nums[i] < rhs, as ext::compare_lt.
+  void (*compare_lt)(const Extended<T>* nums, size_t sz,
+                     const Extended<T>& rhs, uint64_t* mask);
+  // Primitive buffer to extended numbers, mapping infinities as ext::view.
+  void (*convert)(const T* data, size_t sz, Extended<T>* out);
+  // Whitespace separated text, as written by operator<<, to at most
+  // capacity numbers. Returns the number parsed.
+  size_t (*parse)(const char* text, size_t len, Extended<T>* out,
+                  size_t capacity);
+};
+
+namespace detail {
+// Portable kernel bodies. The per-level wrappers below flatten them, so the
+// compiler generates them afresh for each target.
+
+// Elements per block checked for infinities before the primitive loop.
+constexpr size_t DISPATCH_BLOCK = 1024;
+// Independent accumulators, so the loops vectorize without reassociation.
+// The grouping is fixed, so every level returns the same result.
+constexpr size_t DISPATCH_LANES = 8;
+
+template <typename T>
+bool block_finite(const Extended<T>* nums, size_t begin, size_t end) noexcept {
+  int flags = 0;
+  for (size_t i = begin; i < end; ++i) flags |= nums[i].inf_sign();
+  return flags == 0;
+}
+
+template <typename T>
+Extended<T> sum_kernel(const Extended<T>* nums, size_t sz) {
+  Extended<T> total;
+  for (size_t begin = 0; begin < sz; begin += DISPATCH_BLOCK) {
+    const size_t end = std::min(sz, begin + DISPATCH_BLOCK);
+    if (!block_finite(nums, begin, end)) {
+      for (size_t i = begin; i < end; ++i) total += nums[i];
+      continue;
+    }
+    T lanes[DISPATCH_LANES] = {};
+    size_t i = begin;
+    for (; i + DISPATCH_LANES <= end; i += DISPATCH_LANES) {
+      for (size_t l = 0; l < DISPATCH_LANES; ++l) {
+        lanes[l] = static_cast<T>(lanes[l] + nums[i + l].raw_value());
+      }
+    }
+    for (; i < end; ++i) {
+      lanes[0] = static_cast<T>(lanes[0] + nums[i].raw_value());
+    }
+    T block = T(0);
+    for (const T lane : lanes) block = static_cast<T>(block + lane);
+    total += block;
+  }
+  return total;
+}
+
+template <typename T>
+Extended<T> product_kernel(const Extended<T>* nums, size_t sz) {
+  Extended<T> total(T(1));
+  for (size_t begin = 0; begin < sz; begin += DISPATCH_BLOCK) {
+    const size_t end = std::min(sz, begin + DISPATCH_BLOCK);
+    if (!block_finite(nums, begin, end)) {
+      for (size_t i = begin; i < end; ++i) total *= nums[i];
+      continue;
+    }
+    if (!total.finite()) {
+      // An infinite total only needs the zeros and signs of the block.
+      for (size_t i = begin; i < end; ++i) total *= nums[i].raw_value();
+      continue;
+    }
+    T lanes[DISPATCH_LANES];
+    std::fill(lanes, lanes + DISPATCH_LANES, T(1));
+    size_t i = begin;
+    for (; i + DISPATCH_LANES <= end; i += DISPATCH_LANES) {
+      for (size_t l = 0; l < DISPATCH_LANES; ++l) {
+        lanes[l] = static_cast<T>(lanes[l] * nums[i + l].raw_value());
+      }
+    }
+    for (; i < end; ++i) {
+      lanes[0] = static_cast<T>(lanes[0] * nums[i].raw_value());
+    }
+    for (const T lane : lanes) total *= lane;
+  }
+  return total;
+}
+
+template <typename T>
+void convert_kernel(const T* data, size_t sz, Extended<T>* out) {
+  const auto nums = view(data, sz);
+  for (size_t i = 0; i < sz; ++i) out[i] = nums[i];
+}
+
+template <typename T>
+size_t parse_kernel(const char* text, size_t len, Extended<T>* out,
+                    size_t capacity) {
+  const char* pos = text;
+  const char* const last = text + len;
+  size_t count = 0;
+  while (count < capacity) {
+    while (pos != last && std::isspace(static_cast<unsigned char>(*pos))) {
+      ++pos;
+    }
+    if (pos == last) break;
+    const char* token = pos;
+    while (pos != last && !std::isspace(static_cast<unsigned char>(*pos))) {
+      ++pos;
+    }
+    const auto token_len = static_cast<size_t>(pos - token);
+    const auto matches = [&](const char* word) {
+      return token_len == std::strlen(word) &&
+             std::equal(token, pos, word);
+    };
+    if (matches("+inf") || matches("inf")) {
+      out[count++] = Extended<T>(INF::POS);
+      continue;
+    }
+    if (matches("-inf")) {
+      out[count++] = Extended<T>(INF::NEG);
+      continue;
+    }
+    // from_chars rejects the leading '+' that operator<< never writes.
+    T val{};
+    const auto result = std::from_chars(token, pos, val);
+    inf_assert(result.ec == std::errc() && result.ptr == pos,
+               "Parse error: malformed number.");
+    out[count++] = Extended<T>(val);
+  }
+  return count;
+}
+
+// Generates the kernel wrappers of one level.
+#define EXT_DISPATCH_LEVEL(SUFFIX, ATTRIBUTES)                                \
+  template <typename T>                                                       \
+  ATTRIBUTES Extended<T> sum_##SUFFIX(const Extended<T>* nums, size_t sz) {   \
+    return sum_kernel(nums, sz);                                              \
+  }                                                                           \
+  template <typename T>                                                       \
+  ATTRIBUTES Extended<T> product_##SUFFIX(const Extended<T>* nums,            \
+                                          size_t sz) {                        \
+    return product_kernel(nums, sz);                                          \
+  }                                                                           \
+  template <typename T>                                                       \
+  ATTRIBUTES void compare_lt_##SUFFIX(const Extended<T>* nums, size_t sz,     \
+                                      const Extended<T>& rhs,                 \
+                                      uint64_t* mask) {                       \
+    ext::compare_lt(nums, sz, rhs, mask);                                     \
+  }                                                                           \
+  template <typename T>                                                       \
+  ATTRIBUTES void convert_##SUFFIX(const T* data, size_t sz,                  \
+                                   Extended<T>* out) {                        \
+    convert_kernel(data, sz, out);                                            \
+  }                                                                           \
+  template <typename T>                                                       \
+  ATTRIBUTES size_t parse_##SUFFIX(const char* text, size_t len,              \
+                                   Extended<T>* out, size_t capacity) {       \
+    return parse_kernel(text, len, out, capacity);                            \
+  }                                                                           \
+  template <typename T>                                                       \
+  constexpr Kernels<T> kernels_##SUFFIX() noexcept {                          \
+    return {sum_##SUFFIX<T>, product_##SUFFIX<T>, compare_lt_##SUFFIX<T>,     \
+            convert_##SUFFIX<T>, parse_##SUFFIX<T>};                          \
+  }
+
+EXT_DISPATCH_LEVEL(sse2, __attribute__((flatten)))
+#if EXT_DISPATCH_X86
+EXT_DISPATCH_LEVEL(avx2, __attribute__((target("avx2"), flatten)))
+EXT_DISPATCH_LEVEL(avx512,
+                   __attribute__((target("avx512f,avx512dq"), flatten)))
+#endif
+#undef EXT_DISPATCH_LEVEL
+}  // namespace detail
+
+/**
+ * Integer results are identical at every level. Floating point sums and
+ * products add in eight fixed lanes, so they can differ from a sequential
+ * loop in rounding, but never between levels.
+ * @returns The kernels of the active level.
+ */
+template <typename T>
+const Kernels<T>& kernels() noexcept {
+#if EXT_DISPATCH_X86
+  static const Kernels<T> tables[] = {detail::kernels_sse2<T>(),
+                                      detail::kernels_avx2<T>(),
+                                      detail::kernels_avx512<T>()};
+  return tables[static_cast<int>(active_isa())];
+#else
+  static const Kernels<T> table = detail::kernels_sse2<T>();
+  return table;
+#endif
+}
+}  // namespace ext
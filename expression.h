@@ -0,0 +1,239 @@
+/*
+Expression templates for element-wise arithmetic over arrays of extended
+numbers. Chains such as a * b + c - d build a lazy expression that is
+evaluated in a single pass without intermediate arrays.
+
+Copyright 2020. Siwei Wang.
+*/
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+#include "extended.h"
+#include "infinite_error.h"
+
+namespace ext {
+/**
+ * CRTP base of every lazy expression. Derived types provide:
+ * value_type, size(), operator[] with exact Extended semantics, raw() with
+ * plain T arithmetic, and plain() telling whether raw() is exact at an index.
+ */
+template <typename E>
+struct Expr {
+  const E& self() const noexcept { return static_cast<const E&>(*this); }
+};
+
+/**
+ * Leaf referring to an existing array. Does not own the elements.
+ */
+template <typename T>
+class Ref : public Expr<Ref<T>> {
+ private:
+  const Extended<T>* m_data;
+  size_t m_size;
+
+ public:
+  using value_type = T;
+
+  Ref(const Extended<T>* data, size_t sz) noexcept
+      : m_data(data), m_size(sz) {}
+
+  size_t size() const noexcept { return m_size; }
+
+  Extended<T> operator[](size_t idx) const noexcept { return m_data[idx]; }
+
+  T raw(size_t idx) const noexcept { return m_data[idx].raw_value(); }
+
+  bool plain(size_t idx) const noexcept { return m_data[idx].finite(); }
+};
+
+/**
+ * Leaf broadcasting one value to every index.
+ */
+template <typename T>
+class Scalar : public Expr<Scalar<T>> {
+ private:
+  Extended<T> m_value;
+
+ public:
+  using value_type = T;
+
+  explicit Scalar(const Extended<T>& value) noexcept : m_value(value) {}
+
+  // Broadcast leaves adopt the size of the other operand.
+  size_t size() const noexcept { return 0; }
+
+  Extended<T> operator[](size_t) const noexcept { return m_value; }
+
+  T raw(size_t) const noexcept { return m_value.raw_value(); }
+
+  bool plain(size_t) const noexcept { return m_value.finite(); }
+};
+
+namespace detail {
+struct Add {
+  template <typename T>
+  static Extended<T> apply(const Extended<T>& lhs, const Extended<T>& rhs) {
+    return lhs + rhs;
+  }
+  template <typename T>
+  static T raw(T lhs, T rhs) noexcept {
+    return static_cast<T>(lhs + rhs);
+  }
+  static constexpr bool CHECKS_DIVISOR = false;
+};
+
+struct Subtract {
+  template <typename T>
+  static Extended<T> apply(const Extended<T>& lhs, const Extended<T>& rhs) {
+    return lhs - rhs;
+  }
+  template <typename T>
+  static T raw(T lhs, T rhs) noexcept {
+    return static_cast<T>(lhs - rhs);
+  }
+  static constexpr bool CHECKS_DIVISOR = false;
+};
+
+struct Multiply {
+  template <typename T>
+  static Extended<T> apply(const Extended<T>& lhs, const Extended<T>& rhs) {
+    return lhs * rhs;
+  }
+  template <typename T>
+  static T raw(T lhs, T rhs) noexcept {
+    return static_cast<T>(lhs * rhs);
+  }
+  static constexpr bool CHECKS_DIVISOR = false;
+};
+
+struct Divide {
+  template <typename T>
+  static Extended<T> apply(const Extended<T>& lhs, const Extended<T>& rhs) {
+    return lhs / rhs;
+  }
+  template <typename T>
+  static T raw(T lhs, T rhs) noexcept {
+    return static_cast<T>(lhs / rhs);
+  }
+  // Division by zero must take the exact path to raise infinite_error.
+  static constexpr bool CHECKS_DIVISOR = true;
+  template <typename T>
+  static bool plain(T rhs) noexcept {
+    return rhs < static_cast<T>(0) || static_cast<T>(0) < rhs;
+  }
+};
+}  // namespace detail
+
+/**
+ * Lazy element-wise binary operation.
+ */
+template <typename Op, typename L, typename R>
+class Binary : public Expr<Binary<Op, L, R>> {
+ private:
+  L m_lhs;
+  R m_rhs;
+
+ public:
+  using value_type = typename L::value_type;
+
+  Binary(const L& lhs, const R& rhs) : m_lhs(lhs), m_rhs(rhs) {
+    inf_assert(lhs.size() == 0 || rhs.size() == 0 || lhs.size() == rhs.size(),
+               "Expression error: operand sizes differ.");
+  }
+
+  size_t size() const noexcept { return std::max(m_lhs.size(), m_rhs.size()); }
+
+  Extended<value_type> operator[](size_t idx) const {
+    return Op::apply(m_lhs[idx], m_rhs[idx]);
+  }
+
+  value_type raw(size_t idx) const noexcept {
+    return Op::raw(m_lhs.raw(idx), m_rhs.raw(idx));
+  }
+
+  bool plain(size_t idx) const noexcept {
+    const bool operands = m_lhs.plain(idx) & m_rhs.plain(idx);
+    if constexpr (Op::CHECKS_DIVISOR) {
+      // The divisor is only computed once it is known to be finite.
+      return operands && Op::plain(m_rhs.raw(idx));
+    } else {
+      return operands;
+    }
+  }
+};
+
+/**
+ * @param nums The array to wrap.
+ * @returns Leaf expression over nums.
+ */
+template <typename T>
+Ref<T> lazy(const std::vector<Extended<T>>& nums) noexcept {
+  return Ref<T>(nums.data(), nums.size());
+}
+
+/**
+ * Evaluates expr into out in one pass. Each block first checks whether
+ * every operand is finite; if so it runs plain T arithmetic in a loop the
+ * compiler can vectorize, otherwise it applies the Extended rules.
+ * THROWS: infinite_error on indeterminate forms, as the operators do.
+ * @param expr The expression to evaluate.
+ * @param out Array of at least expr.size() elements. May alias a leaf.
+ */
+template <typename E>
+void evaluate(const Expr<E>& expr,
+              Extended<typename E::value_type>* out) {
+  constexpr size_t BLOCK = 256;
+  const E& node = expr.self();
+  const size_t sz = node.size();
+  for (size_t begin = 0; begin < sz; begin += BLOCK) {
+    const size_t end = std::min(sz, begin + BLOCK);
+    bool plain = true;
+    for (size_t i = begin; i < end; ++i) plain &= node.plain(i);
+    if (plain) {
+      for (size_t i = begin; i < end; ++i) out[i] = node.raw(i);
+    } else {
+      for (size_t i = begin; i < end; ++i) out[i] = node[i];
+    }
+  }
+}
+
+/**
+ * @param expr The expression to evaluate.
+ * @returns A new array holding the values of expr.
+ */
+template <typename E>
+std::vector<Extended<typename E::value_type>> evaluate(const Expr<E>& expr) {
+  std::vector<Extended<typename E::value_type>> out(expr.self().size());
+  evaluate(expr, out.data());
+  return out;
+}
+
+// OPERATORS
+
+#define EXT_EXPRESSION_OPERATOR(SYMBOL, OP)                                   \
+  template <typename L, typename R>                                          \
+  Binary<detail::OP, L, R> operator SYMBOL(const Expr<L>& lhs,               \
+                                           const Expr<R>& rhs) {             \
+    return Binary<detail::OP, L, R>(lhs.self(), rhs.self());                 \
+  }                                                                          \
+  template <typename L>                                                      \
+  Binary<detail::OP, L, Scalar<typename L::value_type>> operator SYMBOL(     \
+      const Expr<L>& lhs, const Extended<typename L::value_type>& rhs) {     \
+    return Binary<detail::OP, L, Scalar<typename L::value_type>>(            \
+        lhs.self(), Scalar<typename L::value_type>(rhs));                    \
+  }                                                                          \
+  template <typename R>                                                      \
+  Binary<detail::OP, Scalar<typename R::value_type>, R> operator SYMBOL(     \
+      const Extended<typename R::value_type>& lhs, const Expr<R>& rhs) {     \
+    return Binary<detail::OP, Scalar<typename R::value_type>, R>(            \
+        Scalar<typename R::value_type>(lhs), rhs.self());                    \
+  }
+
+EXT_EXPRESSION_OPERATOR(+, Add)
+EXT_EXPRESSION_OPERATOR(-, Subtract)
+EXT_EXPRESSION_OPERATOR(*, Multiply)
+EXT_EXPRESSION_OPERATOR(/, Divide)
+
+#undef EXT_EXPRESSION_OPERATOR
+}  // namespace ext
@@ -6,25 +6,69 @@ Extended<T> abides by measure-theoretic arithmetic rules.
 Copyright 2020. Siwei Wang.
 */
 #pragma once
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
 #include <iostream>
 #include <type_traits>
 #include "infinite_error.h"
+// Counters are pulled in only when compiled in; otherwise the hooks are
+// no-ops and this header depends on nothing more.
+#if defined(EXT_INSTRUMENT) && EXT_INSTRUMENT
+#include "instrument.h"
+#endif
+#ifndef EXT_COUNT_OP
+#define EXT_COUNT_OP(OP, LHS, RHS) static_cast<void>(0)
+#endif
 
 /**
  * Used to designate positive and negative infinity.
  */
 enum class INF : bool { POS = true, NEG = false };
 
+/**
+ * Customization point for the types Extended<T> accepts. Every non-bool
+ * arithmetic type is accepted. Specialize with is_extendable = true for a
+ * type that is constructible from 0, totally ordered and closed under + and
+ * -; operators the type lacks are simply unavailable on Extended<T>.
+ */
+template <typename T>
+struct numeric_traits {
+  static constexpr bool is_extendable =
+      std::is_arithmetic_v<T> && !std::is_same_v<T, bool>;
+  static constexpr bool is_signed = std::is_signed_v<T>;
+};
+
+/**
+ * Durations, so that +inf can stand for "no timeout".
+ */
+template <typename Rep, typename Period>
+struct numeric_traits<std::chrono::duration<Rep, Period>> {
+  static constexpr bool is_extendable = numeric_traits<Rep>::is_extendable;
+  static constexpr bool is_signed = numeric_traits<Rep>::is_signed;
+};
+
+/**
+ * Used to request construction that leaves the value indeterminate.
+ */
+struct Uninit {
+  explicit Uninit() = default;
+};
+inline constexpr Uninit UNINIT{};
+
 /**
  * Extended number system for type T.
  */
 template <typename T>
 class Extended {
+ public:
   using value_type = T;
-  static_assert(std::is_arithmetic_v<T>, "Extended type must be numeric.");
-  static_assert(!std::is_same_v<T, bool>, "Extended type cannot be bool.");
 
  private:
+  static_assert(numeric_traits<T>::is_extendable,
+                "Extended type must be numeric and not bool.");
+
   // Internal finite value.
   T m_value;
 
@@ -35,6 +79,14 @@ class Extended {
   static constexpr char POS_INF_FLAG = 1;
   static constexpr char NEG_INF_FLAG = -1;
 
+  // Extended arithmetic tests floating point values against zero exactly.
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wfloat-equal"
+  static bool is_zero(const T& number) noexcept {
+    return number == static_cast<T>(0);
+  }
+#pragma GCC diagnostic pop
+
  public:
   // CONSTRUCTION
 
@@ -43,6 +95,12 @@ class Extended {
    */
   Extended() : m_value(static_cast<T>(0)), m_flag(FINITE_FLAG) {}
 
+  /**
+   * Indeterminate value that must be assigned before it is read. Lets bulk
+   * buffers skip writing every element twice.
+   */
+  explicit Extended(Uninit) noexcept {}
+
   /**
    * Parameter-initialized finite value.
    * @param number The initial value.
@@ -105,25 +163,42 @@ class Extended {
     return m_flag == POS_INF_FLAG ? INF::POS : INF::NEG;
   }
 
+  /**
+   * Non-throwing classification for bulk kernels.
+   * @returns 1 if this is +inf, -1 if this is -inf, and 0 if finite.
+   */
+  int inf_sign() const noexcept { return m_flag; }
+
+  /**
+   * Non-throwing access to the stored value for bulk kernels.
+   * WARNING: the result is unspecified if this is infinite.
+   * @returns The stored value.
+   */
+  T raw_value() const noexcept { return m_value; }
+
   /**
    * Convert from one type to another.
    * @returns A casted extended number.
    */
   template <typename S>
   Extended<S> as_type() const {
-    static_assert(std::is_arithmetic_v<S>, "Extended type must be numeric.");
-    static_assert(!std::is_same_v<S, bool>, "Extended type cannot be bool.");
+    static_assert(numeric_traits<S>::is_extendable,
+                  "Extended type must be numeric and not bool.");
     return finite() ? Extended<S>(static_cast<S>(m_value))
                     : Extended<S>(m_flag == POS_INF_FLAG ? INF::POS : INF::NEG);
   }
 
   // COMPARISON
 
+  // Finite values compare exactly, as T does.
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wfloat-equal"
   friend bool operator==(const Extended& num_1,
                          const Extended& num_2) noexcept {
     if (num_1.finite() && num_2.finite()) return num_1.m_value == num_2.m_value;
     return num_1.m_flag == num_2.m_flag;
   }
+#pragma GCC diagnostic pop
 
   friend bool operator!=(const Extended& num_1,
                          const Extended& num_2) noexcept {
@@ -160,7 +235,7 @@ class Extended {
   Extended operator+() const noexcept { return Extended(*this); }
 
   Extended operator-() const noexcept {
-    static_assert(std::is_signed_v<T>,
+    static_assert(numeric_traits<T>::is_signed,
                   "Unary negation only works on signed type.");
     Extended neg;
     if (finite())
@@ -172,7 +247,7 @@ class Extended {
 
   operator bool() const noexcept {
     if (!finite()) return true;
-    return m_value != static_cast<T>(0);
+    return !is_zero(m_value);
   }
 
   // INCREMENT / DECREMENT
@@ -202,6 +277,7 @@ class Extended {
   // ARITHMETIC
 
   Extended& operator+=(const Extended& other) {
+    EXT_COUNT_OP(ADD, m_flag, other.m_flag);
     switch (m_flag) {
       case FINITE_FLAG:
         switch (other.m_flag) {
@@ -245,6 +321,7 @@ class Extended {
   }
 
   Extended& operator-=(const Extended& other) {
+    EXT_COUNT_OP(SUB, m_flag, other.m_flag);
     switch (m_flag) {
       case FINITE_FLAG:
         switch (other.m_flag) {
@@ -288,6 +365,7 @@ class Extended {
   }
 
   Extended& operator*=(const Extended& other) {
+    EXT_COUNT_OP(MUL, m_flag, other.m_flag);
     static constexpr T zero = static_cast<T>(0);
     switch (m_flag) {
       case FINITE_FLAG:
@@ -309,7 +387,7 @@ class Extended {
       case POS_INF_FLAG:
         switch (other.m_flag) {
           case FINITE_FLAG:
-            if (other.m_value == zero) {
+            if (is_zero(other.m_value)) {
               m_value = 0;
               m_flag = FINITE_FLAG;
             } else if (other.m_value < zero) {
@@ -327,7 +405,7 @@ class Extended {
       case NEG_INF_FLAG:
         switch (other.m_flag) {
           case FINITE_FLAG:
-            if (other.m_value == zero) {
+            if (is_zero(other.m_value)) {
               m_value = 0;
               m_flag = FINITE_FLAG;
             } else if (other.m_value < zero) {
@@ -349,12 +427,13 @@ class Extended {
   }
 
   Extended& operator/=(const Extended& other) {
+    EXT_COUNT_OP(DIV, m_flag, other.m_flag);
     static constexpr T zero = static_cast<T>(0);
     switch (m_flag) {
       case FINITE_FLAG:
         switch (other.m_flag) {
           case FINITE_FLAG:
-            inf_assert(other.m_value != zero, "Indeterminate form: +inf / 0");
+            inf_assert(!is_zero(other.m_value), "Indeterminate form: +inf / 0");
             m_value = static_cast<T>(m_value / other.m_value);
             break;
           case POS_INF_FLAG:
@@ -368,7 +447,7 @@ class Extended {
       case POS_INF_FLAG:
         switch (other.m_flag) {
           case FINITE_FLAG:
-            inf_assert(other.m_value != zero, "Indeterminate form: +inf / 0");
+            inf_assert(!is_zero(other.m_value), "Indeterminate form: +inf / 0");
             if (other.m_value < zero) m_flag = NEG_INF_FLAG;
             break;
           case POS_INF_FLAG:
@@ -382,7 +461,7 @@ class Extended {
       case NEG_INF_FLAG:
         switch (other.m_flag) {
           case FINITE_FLAG:
-            inf_assert(other.m_value != zero, "Indeterminate form: +inf / 0");
+            inf_assert(!is_zero(other.m_value), "Indeterminate form: +inf / 0");
             if (other.m_value < zero) m_flag = POS_INF_FLAG;
             break;
           case POS_INF_FLAG:
@@ -400,12 +479,53 @@ class Extended {
   }
 
   Extended& operator%=(const Extended& other) {
+    EXT_COUNT_OP(MOD, m_flag, other.m_flag);
     inf_assert(finite() && other.finite(),
                "Finite error: modular arithmetic requires finite values.");
     m_value = static_cast<T>(m_value % other.m_value);
     return *this;
   }
 
+  // ARITHMETIC WITH FINITE OPERAND
+  // The right operand is known to be finite, so only this flag is examined.
+
+  Extended& operator+=(T number) noexcept {
+    EXT_COUNT_OP(ADD, m_flag, 0);
+    if (finite()) m_value = static_cast<T>(m_value + number);
+    return *this;
+  }
+
+  Extended& operator-=(T number) noexcept {
+    EXT_COUNT_OP(SUB, m_flag, 0);
+    if (finite()) m_value = static_cast<T>(m_value - number);
+    return *this;
+  }
+
+  Extended& operator*=(T number) noexcept {
+    EXT_COUNT_OP(MUL, m_flag, 0);
+    static constexpr T zero = static_cast<T>(0);
+    if (finite()) {
+      m_value = static_cast<T>(m_value * number);
+    } else if (is_zero(number)) {
+      m_value = zero;
+      m_flag = FINITE_FLAG;
+    } else if (number < zero) {
+      m_flag = static_cast<char>(-m_flag);
+    }
+    return *this;
+  }
+
+  Extended& operator/=(T number) {
+    EXT_COUNT_OP(DIV, m_flag, 0);
+    static constexpr T zero = static_cast<T>(0);
+    inf_assert(!is_zero(number), "Indeterminate form: +inf / 0");
+    if (finite())
+      m_value = static_cast<T>(m_value / number);
+    else if (number < zero)
+      m_flag = static_cast<char>(-m_flag);
+    return *this;
+  }
+
   // BITWISE
 
   Extended operator~() const {
@@ -414,6 +534,7 @@ class Extended {
   }
 
   Extended& operator&=(const Extended& other) {
+    EXT_COUNT_OP(AND, m_flag, other.m_flag);
     inf_assert(finite() && other.finite(),
                "Finite error: bitwise and requires finite values.");
     m_value = m_value & other.m_value;
@@ -421,6 +542,7 @@ class Extended {
   }
 
   Extended& operator|=(const Extended& other) {
+    EXT_COUNT_OP(OR, m_flag, other.m_flag);
     inf_assert(finite() && other.finite(),
                "Finite error: bitwise or requires finite values.");
     m_value |= other.m_value;
@@ -428,6 +550,7 @@ class Extended {
   }
 
   Extended& operator^=(const Extended& other) {
+    EXT_COUNT_OP(XOR, m_flag, other.m_flag);
     inf_assert(finite() && other.finite(),
                "Finite error: bitwise xor requires finite values.");
     m_value ^= other.m_value;
@@ -435,6 +558,7 @@ class Extended {
   }
 
   Extended& operator<<=(const Extended& other) {
+    EXT_COUNT_OP(SHL, m_flag, other.m_flag);
     inf_assert(finite() && other.finite(),
                "Finite error: bitwise leftshift requires finite values.");
     m_value = static_cast<T>(m_value << other.m_value);
@@ -442,6 +566,7 @@ class Extended {
   }
 
   Extended& operator>>=(const Extended& other) {
+    EXT_COUNT_OP(SHR, m_flag, other.m_flag);
     inf_assert(finite() && other.finite(),
                "Finite error: bitwise rightshift requires finite values.");
     m_value = static_cast<T>(m_value >> other.m_value);
@@ -529,3 +654,91 @@ Extended<T> operator>>(Extended<T> lhs, const Extended<T>& rhs) {
   lhs >>= rhs;
   return lhs;
 }
+
+// MIXED ARITHMETIC WITH FINITE OPERAND
+// The scalar may be any arithmetic type and is converted to T, so literals
+// such as 2 match exactly instead of reaching the built-in operators
+// through operator bool.
+
+template <typename T, typename S,
+          std::enable_if_t<std::is_arithmetic_v<S>, int> = 0>
+Extended<T> operator+(Extended<T> lhs, S rhs) {
+  lhs += static_cast<T>(rhs);
+  return lhs;
+}
+
+template <typename T, typename S,
+          std::enable_if_t<std::is_arithmetic_v<S>, int> = 0>
+Extended<T> operator+(S lhs, Extended<T> rhs) {
+  rhs += static_cast<T>(lhs);
+  return rhs;
+}
+
+template <typename T, typename S,
+          std::enable_if_t<std::is_arithmetic_v<S>, int> = 0>
+Extended<T> operator-(Extended<T> lhs, S rhs) {
+  lhs -= static_cast<T>(rhs);
+  return lhs;
+}
+
+template <typename T, typename S,
+          std::enable_if_t<std::is_arithmetic_v<S>, int> = 0>
+Extended<T> operator-(S lhs, const Extended<T>& rhs) {
+  if (rhs.finite()) {
+    return Extended<T>(static_cast<T>(static_cast<T>(lhs) - rhs.raw_value()));
+  }
+  return Extended<T>(rhs.inf_sign() > 0 ? INF::NEG : INF::POS);
+}
+
+template <typename T, typename S,
+          std::enable_if_t<std::is_arithmetic_v<S>, int> = 0>
+Extended<T> operator*(Extended<T> lhs, S rhs) {
+  lhs *= static_cast<T>(rhs);
+  return lhs;
+}
+
+template <typename T, typename S,
+          std::enable_if_t<std::is_arithmetic_v<S>, int> = 0>
+Extended<T> operator*(S lhs, Extended<T> rhs) {
+  rhs *= static_cast<T>(lhs);
+  return rhs;
+}
+
+template <typename T, typename S,
+          std::enable_if_t<std::is_arithmetic_v<S>, int> = 0>
+Extended<T> operator/(Extended<T> lhs, S rhs) {
+  lhs /= static_cast<T>(rhs);
+  return lhs;
+}
+
+/**
+ * A finite scalar over an infinity is zero, as in operator/=.
+ */
+template <typename T, typename S,
+          std::enable_if_t<std::is_arithmetic_v<S>, int> = 0>
+Extended<T> operator/(S lhs, const Extended<T>& rhs) {
+  if (!rhs.finite()) return Extended<T>(static_cast<T>(0));
+  Extended<T> quotient(static_cast<T>(lhs));
+  quotient /= rhs.raw_value();
+  return quotient;
+}
+
+namespace std {
+/**
+ * Consistent with operator==: infinite values ignore the stored value and
+ * floating point -0 hashes the same as +0.
+ */
+template <typename T>
+struct hash<Extended<T>> {
+  size_t operator()(const Extended<T>& ext) const noexcept {
+    // Adding zero maps -0 to +0 and leaves every other value unchanged.
+    const T val = ext.finite() ? static_cast<T>(ext.raw_value() + T(0)) : T(0);
+    uint64_t h = static_cast<uint64_t>(hash<T>{}(val));
+    h += static_cast<uint64_t>(ext.inf_sign() + 1) * 0x9E3779B97F4A7C15ULL;
+    // Finalizer from splitmix64 to spread identity hashes of integers.
+    h = (h ^ (h >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    h = (h ^ (h >> 27)) * 0x94D049BB133111EBULL;
+    return static_cast<size_t>(h ^ (h >> 31));
+  }
+};
+}  // namespace std
@@ -0,0 +1,250 @@
+/*
+Elementary functions on extended numbers with limits at infinity:
+log(0) == -inf, exp(-inf) == 0, sqrt(+inf) == +inf, and so on.
+Domain errors and indeterminate forms throw infinite_error.
+
+Copyright 2020. Siwei Wang.
+*/
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <type_traits>
+#include "extended.h"
+#include "infinite_error.h"
+
+// Limits are decided by comparing floating point values exactly.
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wfloat-equal"
+
+namespace ext {
+namespace detail {
+/**
+ * Maps IEEE infinities produced by <cmath> onto extended infinities.
+ * @param number A result of a <cmath> function.
+ * @returns number as an extended value.
+ */
+template <typename T>
+Extended<T> from_ieee(T number) noexcept {
+  if (std::isinf(number)) return Extended<T>(number > 0 ? INF::POS : INF::NEG);
+  return Extended<T>(number);
+}
+
+/**
+ * Applies exact to each element, except that blocks where every element
+ * satisfies plain run fast on plain T values in a loop free of flag checks.
+ */
+template <typename T, typename Plain, typename Fast, typename Exact>
+void transform_batch(const Extended<T>* nums, size_t sz, Extended<T>* out,
+                     Plain plain, Fast fast, Exact exact) {
+  constexpr size_t BLOCK = 256;
+  for (size_t begin = 0; begin < sz; begin += BLOCK) {
+    const size_t end = std::min(sz, begin + BLOCK);
+    bool all_plain = true;
+    for (size_t i = begin; i < end; ++i) {
+      all_plain &= nums[i].finite() && plain(nums[i].raw_value());
+    }
+    if (all_plain) {
+      for (size_t i = begin; i < end; ++i) {
+        out[i] = fast(nums[i].raw_value());
+      }
+    } else {
+      for (size_t i = begin; i < end; ++i) out[i] = exact(nums[i]);
+    }
+  }
+}
+
+template <typename T>
+void require_floating() noexcept {
+  static_assert(std::is_floating_point_v<T>,
+                "Extended math requires floating point.");
+}
+}  // namespace detail
+
+// ORDERING
+
+/**
+ * @returns The lesser of num_1 and num_2 under operator<.
+ */
+template <typename T>
+const Extended<T>& min(const Extended<T>& num_1,
+                       const Extended<T>& num_2) noexcept {
+  return num_2 < num_1 ? num_2 : num_1;
+}
+
+/**
+ * @returns The greater of num_1 and num_2 under operator<.
+ */
+template <typename T>
+const Extended<T>& max(const Extended<T>& num_1,
+                       const Extended<T>& num_2) noexcept {
+  return num_1 < num_2 ? num_2 : num_1;
+}
+
+/**
+ * REQUIRES: !(high < low).
+ * @returns num limited to the range [low, high].
+ */
+template <typename T>
+const Extended<T>& clamp(const Extended<T>& num, const Extended<T>& low,
+                         const Extended<T>& high) {
+  inf_assert(!(high < low), "Domain error: clamp bounds are reversed.");
+  return num < low ? low : (high < num ? high : num);
+}
+
+/**
+ * REQUIRES: num is not the lowest value of a signed integer T, whose
+ * magnitude does not fit in T.
+ * @returns The magnitude of num. Both infinities map to +inf.
+ */
+template <typename T>
+Extended<T> abs(const Extended<T>& num) noexcept {
+  if (!num.finite()) return Extended<T>(INF::POS);
+  if constexpr (std::is_signed_v<T>) {
+    const T val = num.raw_value();
+    return Extended<T>(val < 0 ? static_cast<T>(-val) : val);
+  } else {
+    return num;
+  }
+}
+
+// ELEMENTARY FUNCTIONS
+
+/**
+ * Natural logarithm with log(0) == -inf and log(+inf) == +inf.
+ * THROWS: infinite_error for negative arguments, including -inf.
+ */
+template <typename T>
+Extended<T> log(const Extended<T>& num) {
+  detail::require_floating<T>();
+  inf_assert(!(num < Extended<T>(static_cast<T>(0))),
+             "Domain error: log of a negative value.");
+  if (!num.finite()) return num;
+  if (num.raw_value() == 0) return Extended<T>(INF::NEG);
+  return Extended<T>(std::log(num.raw_value()));
+}
+
+/**
+ * Exponential with exp(-inf) == 0 and exp(+inf) == +inf. Overflow
+ * saturates to +inf.
+ */
+template <typename T>
+Extended<T> exp(const Extended<T>& num) {
+  detail::require_floating<T>();
+  if (!num.finite()) {
+    return num.inf_sign() > 0 ? num : Extended<T>(static_cast<T>(0));
+  }
+  return detail::from_ieee(std::exp(num.raw_value()));
+}
+
+/**
+ * Square root with sqrt(+inf) == +inf.
+ * THROWS: infinite_error for negative arguments, including -inf.
+ */
+template <typename T>
+Extended<T> sqrt(const Extended<T>& num) {
+  detail::require_floating<T>();
+  inf_assert(!(num < Extended<T>(static_cast<T>(0))),
+             "Domain error: sqrt of a negative value.");
+  if (!num.finite()) return num;
+  return Extended<T>(std::sqrt(num.raw_value()));
+}
+
+/**
+ * base raised to exponent, taking limits when either is infinite.
+ * THROWS: infinite_error for negative bases with non-integer exponents,
+ * zero to a negative power, and the indeterminate forms 1^inf, 0^-inf,
+ * and (-inf)^inf. Negative bases to infinite powers only converge when their
+ * magnitude is below 1 for +inf and above 1 for -inf.
+ */
+template <typename T>
+Extended<T> pow(const Extended<T>& base, const Extended<T>& exponent) {
+  detail::require_floating<T>();
+  const T zero = static_cast<T>(0), one = static_cast<T>(1);
+  if (!exponent.finite()) {
+    inf_assert(base.inf_sign() >= 0, "Indeterminate form: (-inf)^inf");
+    if (!base.finite()) {
+      return exponent.inf_sign() > 0 ? base : Extended<T>(zero);
+    }
+    const T mag = std::abs(base.raw_value());
+    inf_assert(mag != one, "Indeterminate form: 1^inf");
+    const bool grows = (mag > one) == (exponent.inf_sign() > 0);
+    if (base.raw_value() < zero) {
+      inf_assert(!grows, "Domain error: negative base to infinite power.");
+    }
+    inf_assert(!grows || mag != zero, "Indeterminate form: 0^-inf");
+    return grows ? Extended<T>(INF::POS) : Extended<T>(zero);
+  }
+  const T power = exponent.raw_value();
+  const bool integral = std::trunc(power) == power;
+  if (!base.finite()) {
+    if (power == zero) return Extended<T>(one);
+    if (power < zero) return Extended<T>(zero);
+    if (base.inf_sign() > 0) return base;
+    inf_assert(integral, "Domain error: -inf to a non-integer power.");
+    return std::fmod(power, static_cast<T>(2)) == zero ? Extended<T>(INF::POS)
+                                                       : base;
+  }
+  const T val = base.raw_value();
+  inf_assert(val >= zero || integral,
+             "Domain error: negative base to a non-integer power.");
+  inf_assert(val != zero || power >= zero,
+             "Indeterminate form: 0 to a negative power.");
+  return detail::from_ieee(std::pow(val, power));
+}
+
+// BATCH VERSIONS
+// Each computes out[i] = f(nums[i]) for sz elements and may write in place.
+
+template <typename T>
+void log(const Extended<T>* nums, size_t sz, Extended<T>* out) {
+  detail::transform_batch(
+      nums, sz, out, [](T val) { return val > 0; },
+      [](T val) { return Extended<T>(std::log(val)); },
+      [](const Extended<T>& num) { return log(num); });
+}
+
+template <typename T>
+void exp(const Extended<T>* nums, size_t sz, Extended<T>* out) {
+  detail::transform_batch(
+      nums, sz, out, [](T) { return true; },
+      [](T val) { return detail::from_ieee(std::exp(val)); },
+      [](const Extended<T>& num) { return exp(num); });
+}
+
+template <typename T>
+void sqrt(const Extended<T>* nums, size_t sz, Extended<T>* out) {
+  detail::transform_batch(
+      nums, sz, out, [](T val) { return val >= 0; },
+      [](T val) { return Extended<T>(std::sqrt(val)); },
+      [](const Extended<T>& num) { return sqrt(num); });
+}
+
+template <typename T>
+void pow(const Extended<T>* nums, size_t sz, const Extended<T>& exponent,
+         Extended<T>* out) {
+  if (!exponent.finite()) {
+    for (size_t i = 0; i < sz; ++i) out[i] = pow(nums[i], exponent);
+    return;
+  }
+  const T power = exponent.raw_value();
+  detail::transform_batch(
+      nums, sz, out, [](T val) { return val > 0; },
+      [=](T val) { return detail::from_ieee(std::pow(val, power)); },
+      [&](const Extended<T>& num) { return pow(num, exponent); });
+}
+
+template <typename T>
+void abs(const Extended<T>* nums, size_t sz, Extended<T>* out) noexcept {
+  for (size_t i = 0; i < sz; ++i) out[i] = abs(nums[i]);
+}
+
+template <typename T>
+void clamp(const Extended<T>* nums, size_t sz, const Extended<T>& low,
+           const Extended<T>& high, Extended<T>* out) {
+  inf_assert(!(high < low), "Domain error: clamp bounds are reversed.");
+  for (size_t i = 0; i < sz; ++i) out[i] = clamp(nums[i], low, high);
+}
+}  // namespace ext
+
+#pragma GCC diagnostic pop
@@ -0,0 +1,123 @@
+/*
+Fused multiply-add, dot product, and matrix-vector product for extended
+numbers. Products follow operator*= (so 0 * inf == 0) and sums follow
+operator+= (so +inf + -inf throws).
+
+Copyright 2020. Siwei Wang.
+*/
+#pragma once
+#include <cmath>
+#include <cstddef>
+#include <type_traits>
+#include "extended.h"
+#include "infinite_error.h"
+
+namespace ext {
+/**
+ * Computes a * b + c. Finite floating point operands round only once.
+ * THROWS: infinite_error if the product and c are opposite infinities.
+ * @returns a * b + c with extended semantics.
+ */
+template <typename T>
+Extended<T> fma(const Extended<T>& a, const Extended<T>& b,
+                const Extended<T>& c) {
+  if (a.finite() & b.finite() & c.finite()) {
+    if constexpr (std::is_floating_point_v<T>) {
+      return Extended<T>(
+          std::fma(a.raw_value(), b.raw_value(), c.raw_value()));
+    } else {
+      return Extended<T>(
+          static_cast<T>(a.raw_value() * b.raw_value() + c.raw_value()));
+    }
+  }
+  auto prod = a;
+  prod *= b;
+  prod += c;
+  return prod;
+}
+
+namespace detail {
+/**
+ * Finite multiply-add used inside bulk kernels. Uses a fused instruction
+ * only when the target has one; emulated fma is far slower than a * b + c.
+ */
+template <typename T>
+T multiply_add(T a, T b, T c) noexcept {
+#if defined(FP_FAST_FMA) && defined(FP_FAST_FMAF)
+  if constexpr (std::is_floating_point_v<T>) return std::fma(a, b, c);
+#endif
+  return static_cast<T>(a * b + c);
+}
+}  // namespace detail
+
+/**
+ * Dot product with extended semantics. Blocks whose operands are all finite
+ * accumulate into independent lanes the compiler can vectorize, so floating
+ * point results may differ from a sequential sum in the last bits.
+ * THROWS: infinite_error if products of opposite infinite sign occur.
+ * @param xs Array of sz elements.
+ * @param ys Array of sz elements.
+ * @param sz Number of elements.
+ * @returns The sum of xs[i] * ys[i].
+ */
+template <typename T>
+Extended<T> dot(const Extended<T>* xs, const Extended<T>* ys, size_t sz) {
+  constexpr size_t BLOCK = 256;
+  constexpr size_t LANES = 4;
+  T lanes[LANES] = {};
+  bool pos_inf = false, neg_inf = false;
+  for (size_t begin = 0; begin < sz; begin += BLOCK) {
+    const size_t end = begin + BLOCK < sz ? begin + BLOCK : sz;
+    bool finite = true;
+    for (size_t i = begin; i < end; ++i) {
+      finite &= xs[i].finite() & ys[i].finite();
+    }
+    if (finite) {
+      size_t i = begin;
+      for (; i + LANES <= end; i += LANES) {
+        for (size_t l = 0; l < LANES; ++l) {
+          lanes[l] = detail::multiply_add(xs[i + l].raw_value(),
+                                          ys[i + l].raw_value(), lanes[l]);
+        }
+      }
+      for (; i < end; ++i) {
+        lanes[0] = detail::multiply_add(xs[i].raw_value(), ys[i].raw_value(),
+                                        lanes[0]);
+      }
+      continue;
+    }
+    for (size_t i = begin; i < end; ++i) {
+      const auto prod = xs[i] * ys[i];
+      const int sign = prod.inf_sign();
+      if (sign == 0) {
+        lanes[0] = static_cast<T>(lanes[0] + prod.raw_value());
+      } else {
+        pos_inf |= sign > 0;
+        neg_inf |= sign < 0;
+      }
+    }
+  }
+  if (pos_inf && neg_inf)
+    throw infinite_error("Indeterminate form: +inf + -inf");
+  if (pos_inf) return Extended<T>(INF::POS);
+  if (neg_inf) return Extended<T>(INF::NEG);
+  T total = static_cast<T>(0);
+  for (size_t l = 0; l < LANES; ++l) total = static_cast<T>(total + lanes[l]);
+  return Extended<T>(total);
+}
+
+/**
+ * Row-major matrix-vector product ys = mat * xs.
+ * THROWS: infinite_error if a row meets opposite infinite products.
+ * @param mat Matrix of rows * cols elements in row-major order.
+ * @param rows Number of rows.
+ * @param cols Number of columns.
+ * @param xs Array of cols elements.
+ * @param ys Output of rows elements.
+ */
+template <typename T>
+void gemv(const Extended<T>* mat, size_t rows, size_t cols,
+          const Extended<T>* xs, Extended<T>* ys) {
+  for (size_t r = 0; r < rows; ++r) ys[r] = dot(mat + r * cols, xs, cols);
+}
+}  // namespace ext
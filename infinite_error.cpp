@@ -4,8 +4,13 @@ Exception for errors with infinity.
 Copyright 2020. Siwei Wang.
 */
 #include "infinite_error.h"
+#include "instrument.h"
 
-infinite_error::infinite_error(const char* prob) : msg(prob) {}
+infinite_error::infinite_error(const char* prob) : msg(prob) {
+#if EXT_INSTRUMENT
+  ext::detail::count_error();
+#endif
+}
 
 const char* infinite_error::what() const noexcept { return msg; }
 
@@ -0,0 +1,129 @@
+/*
+Hot path instrumentation for Extended<T>.
+
+Copyright 2020. Siwei Wang.
+*/
+#include "instrument.h"
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace {
+// Blocks are never freed, so counts of exited threads survive.
+struct Registry {
+  std::mutex mutex;
+  std::vector<std::unique_ptr<ext::detail::CounterBlock>> blocks;
+  std::vector<ext::detail::CounterBlock*> free;
+};
+
+Registry& registry() {
+  // Leaked, so thread exits during static destruction still find it.
+  static Registry* const instance = new Registry();
+  return *instance;
+}
+
+const char* const KIND_NAMES[] = {"-inf", "finite", "+inf"};
+}  // namespace
+
+ext::detail::CounterLease::CounterLease() {
+  Registry& reg = registry();
+  std::lock_guard<std::mutex> lock(reg.mutex);
+  if (reg.free.empty()) {
+    reg.blocks.push_back(std::make_unique<CounterBlock>());
+    m_block = reg.blocks.back().get();
+  } else {
+    m_block = reg.free.back();
+    reg.free.pop_back();
+  }
+}
+
+ext::detail::CounterLease::~CounterLease() {
+  Registry& reg = registry();
+  std::lock_guard<std::mutex> lock(reg.mutex);
+  reg.free.push_back(m_block);
+}
+
+uint64_t ext::OpCounts::total() const noexcept {
+  uint64_t sum = 0;
+  for (const auto& by_op : ops) {
+    for (const auto& by_lhs : by_op) {
+      for (const uint64_t count : by_lhs) sum += count;
+    }
+  }
+  return sum;
+}
+
+ext::OpCounts ext::collect_counts() {
+  OpCounts counts;
+  Registry& reg = registry();
+  std::lock_guard<std::mutex> lock(reg.mutex);
+  for (const auto& block : reg.blocks) {
+    for (size_t op = 0; op < NUM_OPS; ++op) {
+      for (size_t lhs = 0; lhs < 3; ++lhs) {
+        for (size_t rhs = 0; rhs < 3; ++rhs) {
+          counts.ops[op][lhs][rhs] +=
+              block->ops[op][lhs][rhs].load(std::memory_order_relaxed);
+        }
+      }
+    }
+    counts.errors += block->errors.load(std::memory_order_relaxed);
+  }
+  return counts;
+}
+
+void ext::reset_counts() {
+  Registry& reg = registry();
+  std::lock_guard<std::mutex> lock(reg.mutex);
+  for (const auto& block : reg.blocks) {
+    for (auto& by_op : block->ops) {
+      for (auto& by_lhs : by_op) {
+        for (auto& count : by_lhs) count.store(0, std::memory_order_relaxed);
+      }
+    }
+    block->errors.store(0, std::memory_order_relaxed);
+  }
+}
+
+std::string ext::format_counts(const OpCounts& counts, CountFormat format) {
+  std::string out;
+  if (format == CountFormat::PROMETHEUS) {
+    out +=
+        "# HELP extended_operations_total Extended compound operations by "
+        "operand kind.\n"
+        "# TYPE extended_operations_total counter\n";
+  }
+  for (size_t op = 0; op < NUM_OPS; ++op) {
+    for (size_t lhs = 0; lhs < 3; ++lhs) {
+      for (size_t rhs = 0; rhs < 3; ++rhs) {
+        const uint64_t count = counts.ops[op][lhs][rhs];
+        const char* const name = op_name(static_cast<Op>(op));
+        if (format == CountFormat::PROMETHEUS) {
+          // Every series is written, so scrapes see a stable set.
+          out += std::string("extended_operations_total{op=\"") + name +
+                 "\",lhs=\"" + KIND_NAMES[lhs] + "\",rhs=\"" +
+                 KIND_NAMES[rhs] + "\"} " + std::to_string(count) + '\n';
+        } else if (count) {
+          out += std::string(KIND_NAMES[lhs]) + ' ' + name + ' ' +
+                 KIND_NAMES[rhs] + ": " + std::to_string(count) + '\n';
+        }
+      }
+    }
+  }
+  if (format == CountFormat::PROMETHEUS) {
+    out +=
+        "# HELP extended_errors_total infinite_error exceptions raised.\n"
+        "# TYPE extended_errors_total counter\n"
+        "extended_errors_total " +
+        std::to_string(counts.errors) + '\n';
+  } else {
+    out += "errors: " + std::to_string(counts.errors) + '\n';
+  }
+  return out;
+}
+
+bool ext::dump_counts(const std::string& path, CountFormat format) {
+  std::ofstream file(path);
+  file << format_counts(collect_counts(), format);
+  return static_cast<bool>(file);
+}
@@ -0,0 +1,138 @@
+/*
+Hot path instrumentation for Extended<T>. Building with -DEXT_INSTRUMENT=1
+(make instrumented) counts every compound operator by the kinds of its
+operands, and every infinite_error raised, in per-thread counters that are
+summed on demand. Otherwise the hooks compile to nothing.
+
+Copyright 2020. Siwei Wang.
+*/
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#ifndef EXT_INSTRUMENT
+#define EXT_INSTRUMENT 0
+#endif
+
+namespace ext {
+/**
+ * Compound operators, which the binary operators forward to.
+ */
+enum class Op : int {
+  ADD = 0,
+  SUB,
+  MUL,
+  DIV,
+  MOD,
+  AND,
+  OR,
+  XOR,
+  SHL,
+  SHR,
+  NUM_OPS
+};
+
+constexpr size_t NUM_OPS = static_cast<size_t>(Op::NUM_OPS);
+
+/**
+ * @returns The compound operator's spelling, such as "+=".
+ */
+inline const char* op_name(Op op) noexcept {
+  static const char* const names[] = {"+=", "-=", "*=", "/=",  "%=",
+                                      "&=", "|=", "^=", "<<=", ">>="};
+  return names[static_cast<int>(op)];
+}
+
+// Whether the hooks in Extended<T> are compiled in.
+constexpr bool INSTRUMENTED = EXT_INSTRUMENT != 0;
+
+/**
+ * Operation counts summed over threads. Operand kinds are indexed by
+ * infinite sign + 1: -inf, finite, +inf.
+ */
+struct OpCounts {
+  uint64_t ops[NUM_OPS][3][3] = {};
+  // infinite_error exceptions constructed, including inf_assert failures.
+  uint64_t errors = 0;
+
+  /**
+   * @returns Number of operations counted.
+   */
+  uint64_t total() const noexcept;
+};
+
+enum class CountFormat { TEXT, PROMETHEUS };
+
+/**
+ * Sums the counters of every thread, running or exited.
+ */
+OpCounts collect_counts();
+
+/**
+ * Zeroes every counter. Exact only while no thread is counting.
+ */
+void reset_counts();
+
+/**
+ * Text has one line per nonzero count. Prometheus uses the text exposition
+ * format, with counters extended_operations_total and extended_errors_total.
+ */
+std::string format_counts(const OpCounts& counts, CountFormat format);
+
+/**
+ * Writes the current counts to path.
+ * @returns Whether the file was written.
+ */
+bool dump_counts(const std::string& path, CountFormat format);
+
+namespace detail {
+// Written by one thread at a time, read by any, so plain loads and stores
+// suffice and no locked instruction is needed on the hot path.
+struct CounterBlock {
+  std::atomic<uint64_t> ops[NUM_OPS][3][3] = {};
+  std::atomic<uint64_t> errors{0};
+};
+
+/**
+ * Holds a block from the registry for the life of a thread. On exit the
+ * block, counts intact, goes back for reuse by a later thread.
+ */
+class CounterLease {
+  CounterBlock* m_block;
+
+ public:
+  CounterLease();
+  ~CounterLease();
+  CounterLease(const CounterLease&) = delete;
+  CounterLease& operator=(const CounterLease&) = delete;
+
+  CounterBlock& block() const noexcept { return *m_block; }
+};
+
+inline CounterBlock& thread_counters() {
+  thread_local CounterLease lease;
+  return lease.block();
+}
+
+inline void bump(std::atomic<uint64_t>& counter) noexcept {
+  counter.store(counter.load(std::memory_order_relaxed) + 1,
+                std::memory_order_relaxed);
+}
+
+inline void count_op(Op op, int lhs_sign, int rhs_sign) {
+  const auto index = static_cast<size_t>(op);
+  bump(thread_counters().ops[index][lhs_sign + 1][rhs_sign + 1]);
+}
+
+inline void count_error() { bump(thread_counters().errors); }
+}  // namespace detail
+}  // namespace ext
+
+#if EXT_INSTRUMENT
+#define EXT_COUNT_OP(OP, LHS, RHS) \
+  ::ext::detail::count_op(::ext::Op::OP, LHS, RHS)
+#elif !defined(EXT_COUNT_OP)
+#define EXT_COUNT_OP(OP, LHS, RHS) static_cast<void>(0)
+#endif
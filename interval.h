@@ -0,0 +1,316 @@
+/*
+Closed intervals with extended endpoints. Infinite endpoints describe
+half-open and unbounded ranges, and endpoint products use the
+measure-theoretic rule 0 * inf == 0, which is what bound propagation needs.
+
+Copyright 2020. Siwei Wang.
+*/
+#pragma once
+#include <cmath>
+#include <cstddef>
+#include <iostream>
+#include <limits>
+#include <type_traits>
+#include "extended.h"
+#include "extended_math.h"
+#include "infinite_error.h"
+
+namespace ext {
+/**
+ * Rounding of finite floating point endpoints after each operation.
+ * OUTWARD moves each endpoint one ulp away from the interval so the true
+ * result is always contained despite round-to-nearest arithmetic.
+ */
+enum class Rounding : bool { NEAREST = false, OUTWARD = true };
+
+/**
+ * Interval [low, high] of Extended<T> values.
+ */
+template <typename T, Rounding R = Rounding::NEAREST>
+class Interval {
+ private:
+  Extended<T> m_low;
+  Extended<T> m_high;
+
+  // Sign class of an interval, used to pick the endpoint products.
+  static constexpr int NONNEG = 0;
+  static constexpr int NONPOS = 1;
+  static constexpr int MIXED = 2;
+
+  int sign_class() const noexcept {
+    const Extended<T> zero(static_cast<T>(0));
+    if (!(m_low < zero)) return NONNEG;
+    if (!(zero < m_high)) return NONPOS;
+    return MIXED;
+  }
+
+  /**
+   * Widens finite floating point endpoints if rounding is OUTWARD.
+   */
+  Interval& round() noexcept {
+    if constexpr (R == Rounding::OUTWARD && std::is_floating_point_v<T>) {
+      constexpr T huge = std::numeric_limits<T>::infinity();
+      if (m_low.finite()) m_low = std::nextafter(m_low.raw_value(), -huge);
+      if (m_high.finite()) m_high = std::nextafter(m_high.raw_value(), huge);
+    }
+    return *this;
+  }
+
+ public:
+  // CONSTRUCTION
+
+  /**
+   * The degenerate interval [0, 0].
+   */
+  Interval() = default;
+
+  /**
+   * The degenerate interval [point, point].
+   */
+  explicit Interval(const Extended<T>& point) : m_low(point), m_high(point) {}
+
+  /**
+   * REQUIRES: !(high < low).
+   * @param low The lower endpoint.
+   * @param high The upper endpoint.
+   */
+  Interval(const Extended<T>& low, const Extended<T>& high)
+      : m_low(low), m_high(high) {
+    inf_assert(!(high < low), "Interval error: endpoints are reversed.");
+  }
+
+  /**
+   * @returns The interval [-inf, +inf].
+   */
+  static Interval entire() noexcept {
+    Interval all;
+    all.m_low = INF::NEG;
+    all.m_high = INF::POS;
+    return all;
+  }
+
+  // ACCESS
+
+  const Extended<T>& low() const noexcept { return m_low; }
+
+  const Extended<T>& high() const noexcept { return m_high; }
+
+  bool contains(const Extended<T>& num) const noexcept {
+    return !(num < m_low) && !(m_high < num);
+  }
+
+  bool contains_zero() const noexcept {
+    return contains(Extended<T>(static_cast<T>(0)));
+  }
+
+  /**
+   * @returns The smallest interval containing this and other.
+   */
+  Interval hull(const Interval& other) const noexcept {
+    Interval both;
+    both.m_low = min(m_low, other.m_low);
+    both.m_high = max(m_high, other.m_high);
+    return both;
+  }
+
+  friend bool operator==(const Interval& lhs, const Interval& rhs) noexcept {
+    return lhs.m_low == rhs.m_low && lhs.m_high == rhs.m_high;
+  }
+
+  friend bool operator!=(const Interval& lhs, const Interval& rhs) noexcept {
+    return !(lhs == rhs);
+  }
+
+  // ARITHMETIC
+
+  Interval& operator+=(const Interval& other) {
+    m_low += other.m_low;
+    m_high += other.m_high;
+    return round();
+  }
+
+  Interval& operator-=(const Interval& other) {
+    const auto low = m_low - other.m_high;
+    m_high -= other.m_low;
+    m_low = low;
+    return round();
+  }
+
+  /**
+   * Uses the sign classes of both operands so that only the two needed
+   * endpoint products are computed, except when both straddle zero.
+   */
+  Interval& operator*=(const Interval& other) {
+    const auto &al = m_low, &ah = m_high;
+    const auto &bl = other.m_low, &bh = other.m_high;
+    Extended<T> low, high;
+    switch (sign_class() * 3 + other.sign_class()) {
+      case NONNEG * 3 + NONNEG:
+        low = al * bl;
+        high = ah * bh;
+        break;
+      case NONNEG * 3 + NONPOS:
+        low = ah * bl;
+        high = al * bh;
+        break;
+      case NONNEG * 3 + MIXED:
+        low = ah * bl;
+        high = ah * bh;
+        break;
+      case NONPOS * 3 + NONNEG:
+        low = al * bh;
+        high = ah * bl;
+        break;
+      case NONPOS * 3 + NONPOS:
+        low = ah * bh;
+        high = al * bl;
+        break;
+      case NONPOS * 3 + MIXED:
+        low = al * bh;
+        high = al * bl;
+        break;
+      case MIXED * 3 + NONNEG:
+        low = al * bh;
+        high = ah * bh;
+        break;
+      case MIXED * 3 + NONPOS:
+        low = ah * bl;
+        high = al * bl;
+        break;
+      default:
+        low = min(al * bh, ah * bl);
+        high = max(al * bl, ah * bh);
+    }
+    m_low = low;
+    m_high = high;
+    return round();
+  }
+
+  /**
+   * Divisors containing zero produce unbounded results. When the exact
+   * quotient is two disjoint rays, the result is their hull.
+   * REQUIRES: T is floating point.
+   * THROWS: infinite_error when dividing by [0, 0].
+   */
+  Interval& operator/=(const Interval& other) {
+    static_assert(std::is_floating_point_v<T>,
+                  "Interval division requires floating point.");
+    const Extended<T> zero(static_cast<T>(0));
+    const auto &bl = other.m_low, &bh = other.m_high;
+    if (!other.contains_zero()) {
+      // Endpoint quotients, rounded once. An infinity over an infinity is
+      // zero, as the product with the reciprocal 1 / inf == 0 would be.
+      const auto quotient = [&zero](const Extended<T>& x,
+                                    const Extended<T>& y) {
+        return !x.finite() && !y.finite() ? zero : x / y;
+      };
+      const auto &al = m_low, &ah = m_high;
+      Extended<T> low, high;
+      if (other.sign_class() == NONNEG) {
+        switch (sign_class()) {
+          case NONNEG:
+            low = quotient(al, bh);
+            high = quotient(ah, bl);
+            break;
+          case NONPOS:
+            low = quotient(al, bl);
+            high = quotient(ah, bh);
+            break;
+          default:
+            low = quotient(al, bl);
+            high = quotient(ah, bl);
+        }
+      } else {
+        switch (sign_class()) {
+          case NONNEG:
+            low = quotient(ah, bh);
+            high = quotient(al, bl);
+            break;
+          case NONPOS:
+            low = quotient(ah, bl);
+            high = quotient(al, bh);
+            break;
+          default:
+            low = quotient(ah, bh);
+            high = quotient(al, bh);
+        }
+      }
+      m_low = low;
+      m_high = high;
+      return round();
+    }
+    inf_assert(bl < zero || zero < bh, "Indeterminate form: interval / [0, 0]");
+    const int cls = sign_class();
+    const bool positive = cls == NONNEG && zero < m_low;
+    const bool negative = cls == NONPOS && m_high < zero;
+    if ((!positive && !negative) || (bl < zero && zero < bh)) {
+      return *this = entire();
+    }
+    if (bl == zero) {
+      *this = positive ? Interval(m_low / bh, Extended<T>(INF::POS))
+                       : Interval(Extended<T>(INF::NEG), m_high / bh);
+    } else {
+      *this = positive ? Interval(Extended<T>(INF::NEG), m_low / bl)
+                       : Interval(m_high / bl, Extended<T>(INF::POS));
+    }
+    return round();
+  }
+
+  // STREAMS
+
+  friend std::ostream& operator<<(std::ostream& os, const Interval& range) {
+    return os << '[' << range.m_low << ", " << range.m_high << ']';
+  }
+};
+
+template <typename T, Rounding R>
+Interval<T, R> operator+(Interval<T, R> lhs, const Interval<T, R>& rhs) {
+  lhs += rhs;
+  return lhs;
+}
+
+template <typename T, Rounding R>
+Interval<T, R> operator-(Interval<T, R> lhs, const Interval<T, R>& rhs) {
+  lhs -= rhs;
+  return lhs;
+}
+
+template <typename T, Rounding R>
+Interval<T, R> operator*(Interval<T, R> lhs, const Interval<T, R>& rhs) {
+  lhs *= rhs;
+  return lhs;
+}
+
+template <typename T, Rounding R>
+Interval<T, R> operator/(Interval<T, R> lhs, const Interval<T, R>& rhs) {
+  lhs /= rhs;
+  return lhs;
+}
+
+// BATCH PROPAGATION
+// Each computes out[i] = lhs[i] op rhs[i] for sz intervals.
+
+template <typename T, Rounding R>
+void add(const Interval<T, R>* lhs, const Interval<T, R>* rhs, size_t sz,
+         Interval<T, R>* out) {
+  for (size_t i = 0; i < sz; ++i) out[i] = lhs[i] + rhs[i];
+}
+
+template <typename T, Rounding R>
+void subtract(const Interval<T, R>* lhs, const Interval<T, R>* rhs, size_t sz,
+              Interval<T, R>* out) {
+  for (size_t i = 0; i < sz; ++i) out[i] = lhs[i] - rhs[i];
+}
+
+template <typename T, Rounding R>
+void multiply(const Interval<T, R>* lhs, const Interval<T, R>* rhs, size_t sz,
+              Interval<T, R>* out) {
+  for (size_t i = 0; i < sz; ++i) out[i] = lhs[i] * rhs[i];
+}
+
+template <typename T, Rounding R>
+void divide(const Interval<T, R>* lhs, const Interval<T, R>* rhs, size_t sz,
+            Interval<T, R>* out) {
+  for (size_t i = 0; i < sz; ++i) out[i] = lhs[i] / rhs[i];
+}
+}  // namespace ext
@@ -0,0 +1,118 @@
+/*
+Order-preserving binary keys for extended numbers.
+Encoded keys compare with memcmp exactly as operator< compares the values,
+so byte-ordered stores (LSM trees, tries) never need to decode them.
+
+Copyright 2020. Siwei Wang.
+*/
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include "extended.h"
+
+namespace ext {
+namespace detail {
+/**
+ * Unsigned integer with the same width as T.
+ */
+template <typename T>
+using bits_t = std::conditional_t<
+    sizeof(T) == 1, uint8_t,
+    std::conditional_t<
+        sizeof(T) == 2, uint16_t,
+        std::conditional_t<sizeof(T) == 4, uint32_t, uint64_t>>>;
+
+// Leading tag byte. Orders -inf before finite before +inf.
+static constexpr unsigned char NEG_INF_TAG = 0x00;
+static constexpr unsigned char FINITE_TAG = 0x01;
+static constexpr unsigned char POS_INF_TAG = 0x02;
+
+/**
+ * Maps a value to an unsigned integer with the same ordering.
+ * @param number A finite value.
+ * @returns Order-preserving unsigned image of number.
+ */
+template <typename T>
+bits_t<T> to_ordered_bits(T number) noexcept {
+  using U = bits_t<T>;
+  constexpr U sign_bit = static_cast<U>(U(1) << (sizeof(T) * 8 - 1));
+  if constexpr (std::is_floating_point_v<T>) {
+    // Adding zero maps -0 to +0 so equal values get equal keys.
+    const T normal = static_cast<T>(number + T(0));
+    U bits;
+    std::memcpy(&bits, &normal, sizeof(T));
+    return (bits & sign_bit) ? static_cast<U>(~bits)
+                             : static_cast<U>(bits | sign_bit);
+  } else {
+    U bits;
+    std::memcpy(&bits, &number, sizeof(T));
+    return std::is_signed_v<T> ? static_cast<U>(bits ^ sign_bit) : bits;
+  }
+}
+
+/**
+ * Inverse of to_ordered_bits.
+ * @param bits The order-preserving image of a value.
+ * @returns The original value.
+ */
+template <typename T>
+T from_ordered_bits(bits_t<T> bits) noexcept {
+  using U = bits_t<T>;
+  constexpr U sign_bit = static_cast<U>(U(1) << (sizeof(T) * 8 - 1));
+  if constexpr (std::is_floating_point_v<T>) {
+    bits = (bits & sign_bit) ? static_cast<U>(bits ^ sign_bit)
+                             : static_cast<U>(~bits);
+  } else if constexpr (std::is_signed_v<T>) {
+    bits = static_cast<U>(bits ^ sign_bit);
+  }
+  T number;
+  std::memcpy(&number, &bits, sizeof(T));
+  return number;
+}
+}  // namespace detail
+
+/**
+ * Number of bytes in the key of an Extended<T>.
+ */
+template <typename T>
+constexpr size_t key_size = sizeof(T) + 1;
+
+/**
+ * Writes the big-endian key of ext. Infinite values have zero payload.
+ * WARNING: NaN values have no meaningful position in the key order.
+ * @param ext The number to encode.
+ * @param out Buffer of at least key_size<T> bytes.
+ */
+template <typename T>
+void encode_key(const Extended<T>& ext, unsigned char* out) noexcept {
+  static_assert(sizeof(T) <= 8 && (std::is_integral_v<T> || sizeof(T) >= 4),
+                "Key encoding requires an integer, float, or double.");
+  const int sign = ext.inf_sign();
+  out[0] = sign == 0 ? detail::FINITE_TAG
+                     : (sign > 0 ? detail::POS_INF_TAG : detail::NEG_INF_TAG);
+  auto bits = sign == 0 ? detail::to_ordered_bits(ext.raw_value())
+                        : detail::bits_t<T>(0);
+  for (size_t i = sizeof(T); i > 0; --i) {
+    out[i] = static_cast<unsigned char>(bits & 0xFF);
+    bits = static_cast<detail::bits_t<T>>(bits >> 8);
+  }
+}
+
+/**
+ * Reads a key written by encode_key.
+ * @param in Buffer of at least key_size<T> bytes.
+ * @returns The decoded number.
+ */
+template <typename T>
+Extended<T> decode_key(const unsigned char* in) noexcept {
+  if (in[0] == detail::POS_INF_TAG) return Extended<T>(INF::POS);
+  if (in[0] == detail::NEG_INF_TAG) return Extended<T>(INF::NEG);
+  detail::bits_t<T> bits = 0;
+  for (size_t i = 1; i <= sizeof(T); ++i) {
+    bits = static_cast<detail::bits_t<T>>((bits << 8) | in[i]);
+  }
+  return Extended<T>(detail::from_ordered_bits<T>(bits));
+}
+}  // namespace ext
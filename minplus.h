@@ -0,0 +1,281 @@
+/*
+Min-plus convolution of Extended<T> sequences, c[k] = min a[i] + b[k - i],
+as used to merge the cost arrays of knapsack style dynamic programs. A +inf
+entry is an absent term, so leading and trailing +inf runs are trimmed
+before any work, and convex or concave inputs take linear time paths.
+
+Copyright 2020. Siwei Wang.
+*/
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <vector>
+#include "extended.h"
+
+namespace ext {
+namespace detail {
+// Terms of a per block, so a block and its b window stay in cache.
+constexpr size_t MINPLUS_BLOCK = 1024;
+// Independent minima, so the loop vectorizes without fast math.
+constexpr size_t MINPLUS_LANES = 8;
+
+/**
+ * @returns Whether successive differences never decrease.
+ */
+template <typename T>
+bool convex(const std::vector<T>& nums) noexcept {
+  for (size_t i = 2; i < nums.size(); ++i) {
+    if (std::less<T>()(static_cast<T>(nums[i] - nums[i - 1]),
+                       static_cast<T>(nums[i - 1] - nums[i - 2])))
+      return false;
+  }
+  return true;
+}
+
+/**
+ * @returns Whether successive differences never increase.
+ */
+template <typename T>
+bool concave(const std::vector<T>& nums) noexcept {
+  for (size_t i = 2; i < nums.size(); ++i) {
+    if (std::less<T>()(static_cast<T>(nums[i - 1] - nums[i - 2]),
+                       static_cast<T>(nums[i] - nums[i - 1])))
+      return false;
+  }
+  return true;
+}
+
+/**
+ * Both convex: the differences of the result are the merged differences
+ * of a and b, so one pass suffices.
+ */
+template <typename T>
+void merge_convex(const std::vector<T>& a, const std::vector<T>& b, T* out) {
+  size_t i = 0, j = 0;
+  out[0] = static_cast<T>(a[0] + b[0]);
+  for (size_t k = 1; k < a.size() + b.size() - 1; ++k) {
+    // Take the smaller next difference, a first on ties.
+    const bool take_a =
+        j + 1 == b.size() ||
+        (i + 1 < a.size() &&
+         !std::less<T>()(static_cast<T>(b[j + 1] - b[j]),
+                         static_cast<T>(a[i + 1] - a[i])));
+    if (take_a) {
+      ++i;
+    } else {
+      ++j;
+    }
+    out[k] = static_cast<T>(a[i] + b[j]);
+  }
+}
+
+/**
+ * Both concave: each a[i] + b[k - i] is concave in i, so the minimum lies
+ * at an end of the valid range of i.
+ */
+template <typename T>
+void ends_concave(const std::vector<T>& a, const std::vector<T>& b, T* out) {
+  for (size_t k = 0; k < a.size() + b.size() - 1; ++k) {
+    const size_t lo = k < b.size() ? 0 : k - b.size() + 1;
+    const size_t hi = std::min(k, a.size() - 1);
+    const T low = static_cast<T>(a[lo] + b[k - lo]);
+    const T high = static_cast<T>(a[hi] + b[k - hi]);
+    out[k] = std::less<T>()(high, low) ? high : low;
+  }
+}
+
+/**
+ * Row minima of a totally monotone matrix by SMAWK, in O(rows + cols)
+ * entry lookups. Ties go to the leftmost column.
+ * @param rows Row indices, increasing.
+ * @param cols Column indices, increasing.
+ * @param less Orders entry(r, c1) before entry(r, c2).
+ * @param argmin Column of each row's minimum, indexed by row.
+ */
+template <typename Less>
+void smawk(const std::vector<size_t>& rows, const std::vector<size_t>& cols,
+           const Less& less, std::vector<size_t>& argmin) {
+  if (rows.empty()) return;
+  // REDUCE: drop columns that hold no row minimum, leaving at most one
+  // column per row.
+  std::vector<size_t> kept;
+  kept.reserve(rows.size());
+  for (const size_t col : cols) {
+    while (!kept.empty() &&
+           less(rows[kept.size() - 1], col, kept.back())) {
+      kept.pop_back();
+    }
+    if (kept.size() < rows.size()) kept.push_back(col);
+  }
+  std::vector<size_t> odd;
+  for (size_t r = 1; r < rows.size(); r += 2) odd.push_back(rows[r]);
+  smawk(odd, kept, less, argmin);
+  // INTERPOLATE: even rows search between their odd neighbours' minima.
+  size_t start = 0;
+  for (size_t r = 0; r < rows.size(); r += 2) {
+    const size_t stop =
+        r + 1 < rows.size() ? argmin[rows[r + 1]] : kept.back();
+    size_t best = kept[start];
+    size_t c = start;
+    while (kept[c] != stop) {
+      ++c;
+      if (less(rows[r], kept[c], best)) best = kept[c];
+    }
+    argmin[rows[r]] = best;
+    start = c;
+  }
+}
+
+/**
+ * a convex, b arbitrary: M[k][i] = b[i] + a[k - i] is Monge. Out of range
+ * a is extended convexly by penalty steps that outweigh any finite value,
+ * which keeps the whole matrix Monge for SMAWK.
+ */
+template <typename T>
+void smawk_convex(const std::vector<T>& a, const std::vector<T>& b, T* out) {
+  const size_t na = a.size(), rows_count = a.size() + b.size() - 1;
+  // Penalty steps outside a, then the finite part of the entry.
+  const auto entry = [&](size_t k, size_t i, size_t& penalty) {
+    size_t pos;
+    if (i > k) {
+      penalty = i - k;
+      pos = 0;
+    } else if (k - i >= na) {
+      penalty = k - i - na + 1;
+      pos = na - 1;
+    } else {
+      penalty = 0;
+      pos = k - i;
+    }
+    return static_cast<T>(b[i] + a[pos]);
+  };
+  const auto less = [&](size_t k, size_t i, size_t j) {
+    size_t pen_i, pen_j;
+    const T val_i = entry(k, i, pen_i);
+    const T val_j = entry(k, j, pen_j);
+    if (pen_i != pen_j) return pen_i < pen_j;
+    return std::less<T>()(val_i, val_j);
+  };
+  std::vector<size_t> rows(rows_count), cols(b.size());
+  for (size_t k = 0; k < rows_count; ++k) rows[k] = k;
+  for (size_t i = 0; i < b.size(); ++i) cols[i] = i;
+  std::vector<size_t> argmin(rows_count);
+  smawk(rows, cols, less, argmin);
+  for (size_t k = 0; k < rows_count; ++k) {
+    out[k] = static_cast<T>(b[argmin[k]] + a[k - argmin[k]]);
+  }
+}
+
+/**
+ * General case over finite terms in O(na nb). b is reversed so each
+ * output is a contiguous sum and minimum, taken a block of a at a time.
+ */
+template <typename T>
+void blocked_general(const std::vector<T>& a, const std::vector<T>& b,
+                     T* out) {
+  const size_t na = a.size(), nb = b.size();
+  const std::vector<T> rev(b.rbegin(), b.rend());
+  for (size_t k = 0; k < na + nb - 1; ++k) {
+    const size_t lo = k < nb ? 0 : k - nb + 1;
+    out[k] = static_cast<T>(a[lo] + b[k - lo]);
+  }
+  for (size_t begin = 0; begin < na; begin += MINPLUS_BLOCK) {
+    const size_t end = std::min(na, begin + MINPLUS_BLOCK);
+    for (size_t k = begin; k < end + nb - 1; ++k) {
+      // Terms i in [lo, hi) pair with rev[nb - 1 - k + i].
+      const size_t lo = std::max(begin, k < nb ? 0 : k - nb + 1);
+      const size_t hi = std::min(end, k + 1);
+      const T* const x = a.data() + lo;
+      const T* const y = rev.data() + (nb - 1 + lo - k);
+      const size_t len = hi - lo;
+      T lanes[MINPLUS_LANES];
+      std::fill(lanes, lanes + MINPLUS_LANES, out[k]);
+      size_t t = 0;
+      for (; t + MINPLUS_LANES <= len; t += MINPLUS_LANES) {
+        for (size_t l = 0; l < MINPLUS_LANES; ++l) {
+          const T sum = static_cast<T>(x[t + l] + y[t + l]);
+          lanes[l] = std::less<T>()(sum, lanes[l]) ? sum : lanes[l];
+        }
+      }
+      for (; t < len; ++t) {
+        const T sum = static_cast<T>(x[t] + y[t]);
+        lanes[0] = std::less<T>()(sum, lanes[0]) ? sum : lanes[0];
+      }
+      T best = lanes[0];
+      for (const T lane : lanes) {
+        best = std::less<T>()(lane, best) ? lane : best;
+      }
+      out[k] = best;
+    }
+  }
+}
+}  // namespace detail
+
+/**
+ * Min-plus convolution, c[k] = min over i of a[i] + b[k - i]. A +inf entry
+ * is an absent term and never meets -inf. After trimming +inf runs at both
+ * ends, finite inputs dispatch on shape: both convex merge differences,
+ * both concave check the ends of each range, one convex runs SMAWK, and
+ * otherwise a blocked O(na nb) kernel runs. Interior infinities fall back
+ * to Extended arithmetic. For floating point T, fast paths may pick a
+ * different term among near ties.
+ * REQUIRES: Sums of finite entries fit in T.
+ * @param a Array of na numbers.
+ * @param b Array of nb numbers.
+ * @returns na + nb - 1 numbers, +inf where no terms exist, or nothing if
+ * either input is empty.
+ */
+template <typename T>
+std::vector<Extended<T>> minplus_convolve(const Extended<T>* a, size_t na,
+                                          const Extended<T>* b, size_t nb) {
+  if (!na || !nb) return {};
+  const Extended<T> pos_inf(INF::POS);
+  std::vector<Extended<T>> result(na + nb - 1, pos_inf);
+  size_t a_begin = 0, a_end = na, b_begin = 0, b_end = nb;
+  while (a_begin < a_end && a[a_begin] == pos_inf) ++a_begin;
+  while (a_begin < a_end && a[a_end - 1] == pos_inf) --a_end;
+  while (b_begin < b_end && b[b_begin] == pos_inf) ++b_begin;
+  while (b_begin < b_end && b[b_end - 1] == pos_inf) --b_end;
+  if (a_begin == a_end || b_begin == b_end) return result;
+
+  const auto finite = [](const Extended<T>* nums, size_t begin, size_t end) {
+    int flags = 0;
+    for (size_t i = begin; i < end; ++i) flags |= nums[i].inf_sign();
+    return flags == 0;
+  };
+  const size_t offset = a_begin + b_begin;
+  if (!finite(a, a_begin, a_end) || !finite(b, b_begin, b_end)) {
+    for (size_t i = a_begin; i < a_end; ++i) {
+      if (a[i] == pos_inf) continue;
+      for (size_t j = b_begin; j < b_end; ++j) {
+        if (b[j] == pos_inf) continue;
+        const Extended<T> sum = a[i] + b[j];
+        if (sum < result[i + j]) result[i + j] = sum;
+      }
+    }
+    return result;
+  }
+
+  std::vector<T> x(a_end - a_begin), y(b_end - b_begin);
+  for (size_t i = 0; i < x.size(); ++i) x[i] = a[a_begin + i].raw_value();
+  for (size_t j = 0; j < y.size(); ++j) y[j] = b[b_begin + j].raw_value();
+  std::vector<T> out(x.size() + y.size() - 1);
+  const bool x_convex = detail::convex(x), y_convex = detail::convex(y);
+  if (x_convex && y_convex) {
+    detail::merge_convex(x, y, out.data());
+  } else if (detail::concave(x) && detail::concave(y)) {
+    detail::ends_concave(x, y, out.data());
+  } else if (x_convex) {
+    detail::smawk_convex(x, y, out.data());
+  } else if (y_convex) {
+    detail::smawk_convex(y, x, out.data());
+  } else {
+    detail::blocked_general(x, y, out.data());
+  }
+  for (size_t k = 0; k < out.size(); ++k) {
+    result[offset + k] = Extended<T>(out[k]);
+  }
+  return result;
+}
+}  // namespace ext
@@ -0,0 +1,129 @@
+/*
+Hardware performance counters for the benchmark harness.
+
+Copyright 2020. Siwei Wang.
+*/
+#include "perf_counters.h"
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <cstring>
+#endif
+
+namespace {
+#if defined(__linux__)
+struct EventConfig {
+  uint32_t type;
+  uint64_t config;
+};
+
+constexpr uint64_t cache_config(uint64_t cache) {
+  return cache | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+         (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+}
+
+constexpr EventConfig CONFIGS[PerfCounters::NUM_EVENTS] = {
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+    {PERF_TYPE_HW_CACHE, cache_config(PERF_COUNT_HW_CACHE_L1D)},
+    {PERF_TYPE_HW_CACHE, cache_config(PERF_COUNT_HW_CACHE_LL)}};
+
+int open_counter(const EventConfig& event) noexcept {
+  perf_event_attr attr;
+  std::memset(&attr, 0, sizeof(attr));
+  attr.size = sizeof(attr);
+  attr.type = event.type;
+  attr.config = event.config;
+  attr.disabled = 1;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  attr.read_format =
+      PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+  return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+}
+#endif
+}  // namespace
+
+const char* PerfCounters::name(Event event) noexcept {
+  switch (event) {
+    case CYCLES:
+      return "cycles";
+    case INSTRUCTIONS:
+      return "instructions";
+    case BRANCH_MISSES:
+      return "branch-misses";
+    case L1D_MISSES:
+      return "L1d-misses";
+    case LLC_MISSES:
+      return "LLC-misses";
+    default:
+      return "unknown";
+  }
+}
+
+PerfCounters::PerfCounters() noexcept {
+  for (size_t e = 0; e < NUM_EVENTS; ++e) {
+    m_values[e] = 0;
+#if defined(__linux__)
+    m_fds[e] = open_counter(CONFIGS[e]);
+#else
+    m_fds[e] = -1;
+#endif
+  }
+}
+
+PerfCounters::~PerfCounters() {
+#if defined(__linux__)
+  for (const int fd : m_fds) {
+    if (fd >= 0) close(fd);
+  }
+#endif
+}
+
+bool PerfCounters::available(Event event) const noexcept {
+  return m_fds[event] >= 0;
+}
+
+bool PerfCounters::available() const noexcept {
+  for (size_t e = 0; e < NUM_EVENTS; ++e) {
+    if (available(static_cast<Event>(e))) return true;
+  }
+  return false;
+}
+
+void PerfCounters::start() noexcept {
+#if defined(__linux__)
+  for (const int fd : m_fds) {
+    if (fd < 0) continue;
+    ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+    ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+  }
+#endif
+}
+
+void PerfCounters::stop() noexcept {
+#if defined(__linux__)
+  for (size_t e = 0; e < NUM_EVENTS; ++e) {
+    if (m_fds[e] < 0) continue;
+    ioctl(m_fds[e], PERF_EVENT_IOC_DISABLE, 0);
+    // Count, time enabled, time running.
+    uint64_t data[3] = {0, 0, 0};
+    m_values[e] = 0;
+    if (read(m_fds[e], data, sizeof(data)) != sizeof(data) || !data[2]) {
+      continue;
+    }
+    m_values[e] = data[1] == data[2]
+                      ? data[0]
+                      : static_cast<uint64_t>(static_cast<double>(data[0]) *
+                                              static_cast<double>(data[1]) /
+                                              static_cast<double>(data[2]));
+  }
+#endif
+}
+
+uint64_t PerfCounters::value(Event event) const noexcept {
+  return m_values[event];
+}
@@ -0,0 +1,67 @@
+/*
+Hardware performance counters for the benchmark harness, read through
+perf_event_open on Linux. Counters that cannot be opened, or any counter on
+other systems, are reported as unavailable.
+
+Copyright 2020. Siwei Wang.
+*/
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+class PerfCounters {
+ public:
+  enum Event : size_t {
+    CYCLES,
+    INSTRUCTIONS,
+    BRANCH_MISSES,
+    L1D_MISSES,
+    LLC_MISSES,
+    NUM_EVENTS
+  };
+
+  /**
+   * @returns A short name for event.
+   */
+  static const char* name(Event event) noexcept;
+
+  /**
+   * Opens every counter this process may read, counting user space only.
+   */
+  PerfCounters() noexcept;
+
+  ~PerfCounters();
+
+  PerfCounters(const PerfCounters&) = delete;
+  PerfCounters& operator=(const PerfCounters&) = delete;
+
+  /**
+   * @returns Whether event can be counted.
+   */
+  bool available(Event event) const noexcept;
+
+  /**
+   * @returns Whether any event can be counted.
+   */
+  bool available() const noexcept;
+
+  /**
+   * Resets and enables the open counters.
+   */
+  void start() noexcept;
+
+  /**
+   * Disables the open counters and reads them, scaling any that the kernel
+   * multiplexed for part of the interval.
+   */
+  void stop() noexcept;
+
+  /**
+   * @returns The count of event between the last start() and stop().
+   */
+  uint64_t value(Event event) const noexcept;
+
+ private:
+  int m_fds[NUM_EVENTS];
+  uint64_t m_values[NUM_EVENTS];
+};
@@ -0,0 +1,297 @@
+/*
+Array of extended numbers that are almost all finite. Values live in a plain
+T array and the few infinities in a sorted index, so reductions and
+elementwise operations run primitive loops and settle infinities in O(k).
+
+Copyright 2020. Siwei Wang.
+*/
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <vector>
+#include "extended.h"
+#include "infinite_error.h"
+
+namespace ext {
+template <typename T>
+class SparseInfArray {
+  // Invariant: m_values holds T(0) at every infinite position, and
+  // m_inf_idx is strictly increasing.
+  std::vector<T> m_values;
+  std::vector<size_t> m_inf_idx;
+  std::vector<int8_t> m_inf_sign;
+
+  /**
+   * @returns Position of idx in the infinity index, or inf_count().
+   */
+  size_t find(size_t idx) const noexcept {
+    const auto found =
+        std::lower_bound(m_inf_idx.begin(), m_inf_idx.end(), idx);
+    if (found == m_inf_idx.end() || *found != idx) return m_inf_idx.size();
+    return static_cast<size_t>(found - m_inf_idx.begin());
+  }
+
+  static Extended<T> infinity(int8_t sign) noexcept {
+    return Extended<T>(sign > 0 ? INF::POS : INF::NEG);
+  }
+
+  /**
+   * Applies op element by element. The infinity indexes are merged first
+   * and only the positions they name go through the Extended operator, so
+   * a throw leaves this array unchanged. The remaining positions run the
+   * primitive loop.
+   * THROWS: infinite_error on an indeterminate form.
+   */
+  template <typename ExtOp, typename RawOp>
+  SparseInfArray& combine(const SparseInfArray& other, ExtOp ext_op,
+                          RawOp raw_op) {
+    inf_assert(size() == other.size(),
+               "Sparse array error: operand sizes differ.");
+    std::vector<size_t> merged;
+    merged.reserve(m_inf_idx.size() + other.m_inf_idx.size());
+    std::set_union(m_inf_idx.begin(), m_inf_idx.end(),
+                   other.m_inf_idx.begin(), other.m_inf_idx.end(),
+                   std::back_inserter(merged));
+    std::vector<Extended<T>> results;
+    results.reserve(merged.size());
+    for (const size_t idx : merged) {
+      results.push_back(ext_op((*this)[idx], other[idx]));
+    }
+    T* values = m_values.data();
+    const T* others = other.m_values.data();
+    for (size_t i = 0; i < m_values.size(); ++i) {
+      values[i] = static_cast<T>(raw_op(values[i], others[i]));
+    }
+    m_inf_idx.clear();
+    m_inf_sign.clear();
+    for (size_t k = 0; k < merged.size(); ++k) {
+      const int sign = results[k].inf_sign();
+      values[merged[k]] = sign ? T(0) : results[k].raw_value();
+      if (sign) {
+        m_inf_idx.push_back(merged[k]);
+        m_inf_sign.push_back(static_cast<int8_t>(sign));
+      }
+    }
+    return *this;
+  }
+
+  /**
+   * Folds the finite values between consecutive infinities with op.
+   * REQUIRES: At least one finite value.
+   */
+  template <typename Op>
+  T fold_finite(Op op) const {
+    bool started = false;
+    T acc = T(0);
+    size_t begin = 0;
+    for (size_t k = 0; k <= m_inf_idx.size(); ++k) {
+      const size_t end = k < m_inf_idx.size() ? m_inf_idx[k] : size();
+      for (size_t i = begin; i < end; ++i) {
+        acc = started ? op(acc, m_values[i]) : m_values[i];
+        started = true;
+      }
+      begin = end + 1;
+    }
+    return acc;
+  }
+
+ public:
+  SparseInfArray() = default;
+
+  /**
+   * Constructs sz finite zeros.
+   */
+  explicit SparseInfArray(size_t sz) : m_values(sz, T(0)) {}
+
+  /**
+   * Converts sz extended numbers.
+   * @param nums Array of sz elements.
+   * @param sz Number of elements.
+   */
+  SparseInfArray(const Extended<T>* nums, size_t sz) : m_values(sz) {
+    for (size_t i = 0; i < sz; ++i) {
+      const int sign = nums[i].inf_sign();
+      m_values[i] = sign ? T(0) : nums[i].raw_value();
+      if (sign) {
+        m_inf_idx.push_back(i);
+        m_inf_sign.push_back(static_cast<int8_t>(sign));
+      }
+    }
+  }
+
+  size_t size() const noexcept { return m_values.size(); }
+
+  size_t inf_count() const noexcept { return m_inf_idx.size(); }
+
+  /**
+   * @returns The value array, holding zero at infinite positions.
+   */
+  const T* data() const noexcept { return m_values.data(); }
+
+  /**
+   * @returns Sorted positions of the infinite elements.
+   */
+  const std::vector<size_t>& inf_positions() const noexcept {
+    return m_inf_idx;
+  }
+
+  /**
+   * @param idx Index below size().
+   * @returns Element idx, found in O(log k).
+   */
+  Extended<T> operator[](size_t idx) const noexcept {
+    const size_t pos = find(idx);
+    if (pos != m_inf_idx.size()) return infinity(m_inf_sign[pos]);
+    return Extended<T>(m_values[idx]);
+  }
+
+  /**
+   * Overwrites element idx in O(k) time.
+   * @param idx Index below size().
+   * @param num The new element.
+   */
+  void set(size_t idx, const Extended<T>& num) {
+    const auto found =
+        std::lower_bound(m_inf_idx.begin(), m_inf_idx.end(), idx);
+    const auto pos = found - m_inf_idx.begin();
+    const bool present = found != m_inf_idx.end() && *found == idx;
+    const int sign = num.inf_sign();
+    m_values[idx] = sign ? T(0) : num.raw_value();
+    if (sign && present) {
+      m_inf_sign[static_cast<size_t>(pos)] = static_cast<int8_t>(sign);
+    } else if (sign) {
+      m_inf_idx.insert(found, idx);
+      m_inf_sign.insert(m_inf_sign.begin() + pos, static_cast<int8_t>(sign));
+    } else if (present) {
+      m_inf_idx.erase(found);
+      m_inf_sign.erase(m_inf_sign.begin() + pos);
+    }
+  }
+
+  /**
+   * @returns Every element as a dense array.
+   */
+  std::vector<Extended<T>> to_extended() const {
+    std::vector<Extended<T>> out;
+    out.reserve(size());
+    for (const T val : m_values) out.emplace_back(val);
+    for (size_t k = 0; k < m_inf_idx.size(); ++k) {
+      out[m_inf_idx[k]] = infinity(m_inf_sign[k]);
+    }
+    return out;
+  }
+
+  // REDUCTIONS
+
+  /**
+   * Sum with the rules of operator+=. Infinities are settled from the index;
+   * otherwise the primitive loop runs over the values.
+   * THROWS: infinite_error if the array holds both +inf and -inf.
+   * @returns The sum of all elements.
+   */
+  Extended<T> sum() const {
+    const bool pos_inf = std::find(m_inf_sign.begin(), m_inf_sign.end(),
+                                   int8_t(1)) != m_inf_sign.end();
+    const bool neg_inf = std::find(m_inf_sign.begin(), m_inf_sign.end(),
+                                   int8_t(-1)) != m_inf_sign.end();
+    if (pos_inf && neg_inf)
+      throw infinite_error("Indeterminate form: +inf + -inf");
+    if (pos_inf) return Extended<T>(INF::POS);
+    if (neg_inf) return Extended<T>(INF::NEG);
+    T total = T(0);
+    for (const T val : m_values) total = static_cast<T>(total + val);
+    return Extended<T>(total);
+  }
+
+  /**
+   * THROWS: infinite_error if the array is empty.
+   * @returns The least element.
+   */
+  Extended<T> min() const {
+    inf_assert(size() > 0, "Sparse array error: empty array.");
+    if (std::find(m_inf_sign.begin(), m_inf_sign.end(), int8_t(-1)) !=
+        m_inf_sign.end())
+      return Extended<T>(INF::NEG);
+    if (inf_count() == size()) return Extended<T>(INF::POS);
+    return Extended<T>(fold_finite(
+        [](T lhs, T rhs) { return std::less<T>()(rhs, lhs) ? rhs : lhs; }));
+  }
+
+  /**
+   * THROWS: infinite_error if the array is empty.
+   * @returns The greatest element.
+   */
+  Extended<T> max() const {
+    inf_assert(size() > 0, "Sparse array error: empty array.");
+    if (std::find(m_inf_sign.begin(), m_inf_sign.end(), int8_t(1)) !=
+        m_inf_sign.end())
+      return Extended<T>(INF::POS);
+    if (inf_count() == size()) return Extended<T>(INF::NEG);
+    return Extended<T>(fold_finite(
+        [](T lhs, T rhs) { return std::less<T>()(lhs, rhs) ? rhs : lhs; }));
+  }
+
+  // ELEMENTWISE ARITHMETIC
+  // Each throws what the Extended operator would, leaving this unchanged.
+
+  SparseInfArray& operator+=(const SparseInfArray& other) {
+    return combine(
+        other,
+        [](Extended<T> lhs, const Extended<T>& rhs) { return lhs += rhs; },
+        [](T lhs, T rhs) { return lhs + rhs; });
+  }
+
+  SparseInfArray& operator-=(const SparseInfArray& other) {
+    return combine(
+        other,
+        [](Extended<T> lhs, const Extended<T>& rhs) { return lhs -= rhs; },
+        [](T lhs, T rhs) { return lhs - rhs; });
+  }
+
+  SparseInfArray& operator*=(const SparseInfArray& other) {
+    return combine(
+        other,
+        [](Extended<T> lhs, const Extended<T>& rhs) { return lhs *= rhs; },
+        [](T lhs, T rhs) { return lhs * rhs; });
+  }
+
+  /**
+   * Multiplies every element by a finite factor. A zero factor clears the
+   * index, since 0 * inf == 0; a negative one flips every sign.
+   */
+  SparseInfArray& operator*=(T factor) noexcept {
+    for (T& val : m_values) val = static_cast<T>(val * factor);
+    if (std::equal_to<T>()(factor, T(0))) {
+      m_inf_idx.clear();
+      m_inf_sign.clear();
+    } else if (std::less<T>()(factor, T(0))) {
+      for (int8_t& sign : m_inf_sign) sign = static_cast<int8_t>(-sign);
+    }
+    return *this;
+  }
+};
+
+template <typename T>
+SparseInfArray<T> operator+(SparseInfArray<T> lhs,
+                            const SparseInfArray<T>& rhs) {
+  lhs += rhs;
+  return lhs;
+}
+
+template <typename T>
+SparseInfArray<T> operator-(SparseInfArray<T> lhs,
+                            const SparseInfArray<T>& rhs) {
+  lhs -= rhs;
+  return lhs;
+}
+
+template <typename T>
+SparseInfArray<T> operator*(SparseInfArray<T> lhs,
+                            const SparseInfArray<T>& rhs) {
+  lhs *= rhs;
+  return lhs;
+}
+}  // namespace ext
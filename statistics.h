@@ -0,0 +1,283 @@
+/*
+Single-pass statistics over streams of extended numbers. Infinite values are
+counted exactly, finite values feed Welford moments and a KLL quantile
+sketch, and every aggregator can be merged with another built elsewhere.
+
+Copyright 2020. Siwei Wang.
+*/
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+#include "extended.h"
+#include "infinite_error.h"
+
+namespace ext {
+/**
+ * KLL sketch of finite values. Level h holds items of weight 2^h, and a
+ * full level is compacted by sorting it and promoting every other item.
+ * Infinities are counted exactly so they always rank at the extremes.
+ */
+template <typename T>
+class QuantileSketch {
+ private:
+  std::vector<std::vector<T>> m_levels;
+  size_t m_k;
+  size_t m_stored = 0;
+  size_t m_finite = 0;
+  size_t m_pos_inf = 0;
+  size_t m_neg_inf = 0;
+  uint64_t m_random = 0x9E3779B97F4A7C15ULL;
+
+  /**
+   * @param level The level index.
+   * @returns Capacity of level, shrinking by 2/3 per level below the top.
+   */
+  size_t capacity(size_t level) const noexcept {
+    const auto depth = static_cast<double>(m_levels.size() - level - 1);
+    const auto cap = std::ceil(static_cast<double>(m_k) *
+                               std::pow(2.0 / 3.0, depth));
+    return std::max<size_t>(2, static_cast<size_t>(cap));
+  }
+
+  /**
+   * @returns A pseudo-random bit from an xorshift generator.
+   */
+  size_t coin() noexcept {
+    m_random ^= m_random << 13;
+    m_random ^= m_random >> 7;
+    m_random ^= m_random << 17;
+    return static_cast<size_t>(m_random >> 63);
+  }
+
+  /**
+   * Compacts the lowest full level until the sketch is within capacity.
+   */
+  void compress() {
+    for (;;) {
+      size_t total = 0;
+      for (size_t h = 0; h < m_levels.size(); ++h) total += capacity(h);
+      if (m_stored < total) return;
+      for (size_t h = 0; h < m_levels.size(); ++h) {
+        if (m_levels[h].size() < capacity(h)) continue;
+        if (h + 1 == m_levels.size()) m_levels.emplace_back();
+        auto& level = m_levels[h];
+        auto& above = m_levels[h + 1];
+        std::sort(level.begin(), level.end());
+        // An odd item out stays behind so total weight is preserved.
+        const size_t paired = level.size() & ~size_t(1);
+        for (size_t i = coin(); i < paired; i += 2) above.push_back(level[i]);
+        m_stored -= paired / 2;
+        level.erase(level.begin(),
+                    level.begin() + static_cast<std::ptrdiff_t>(paired));
+        break;
+      }
+    }
+  }
+
+  /**
+   * @returns Every stored finite item with its weight, sorted by value.
+   */
+  std::vector<std::pair<T, size_t>> weighted() const {
+    std::vector<std::pair<T, size_t>> items;
+    items.reserve(m_stored);
+    for (size_t h = 0; h < m_levels.size(); ++h) {
+      for (const T val : m_levels[h]) items.emplace_back(val, size_t(1) << h);
+    }
+    std::sort(items.begin(), items.end());
+    return items;
+  }
+
+ public:
+  /**
+   * @param k Accuracy parameter. Rank error shrinks roughly as 1 / k.
+   */
+  explicit QuantileSketch(size_t k = 200) : m_levels(1), m_k(k) {
+    inf_assert(k >= 8, "Sketch error: k must be at least 8.");
+  }
+
+  /**
+   * @param num The value to record.
+   */
+  void insert(const Extended<T>& num) {
+    const int sign = num.inf_sign();
+    if (sign > 0) {
+      ++m_pos_inf;
+    } else if (sign < 0) {
+      ++m_neg_inf;
+    } else {
+      m_levels[0].push_back(num.raw_value());
+      ++m_stored;
+      ++m_finite;
+      compress();
+    }
+  }
+
+  /**
+   * Absorbs all values recorded by other.
+   * @param other A sketch with the same k.
+   */
+  void merge(const QuantileSketch& other) {
+    inf_assert(m_k == other.m_k, "Sketch error: merging different k.");
+    if (m_levels.size() < other.m_levels.size())
+      m_levels.resize(other.m_levels.size());
+    for (size_t h = 0; h < other.m_levels.size(); ++h) {
+      m_levels[h].insert(m_levels[h].end(), other.m_levels[h].begin(),
+                         other.m_levels[h].end());
+    }
+    m_stored += other.m_stored;
+    m_finite += other.m_finite;
+    m_pos_inf += other.m_pos_inf;
+    m_neg_inf += other.m_neg_inf;
+    compress();
+  }
+
+  /**
+   * @returns Number of recorded values.
+   */
+  size_t count() const noexcept { return m_finite + m_pos_inf + m_neg_inf; }
+
+  /**
+   * REQUIRES: At least one value was recorded.
+   * @param num The value to rank.
+   * @returns Estimated fraction of recorded values <= num.
+   */
+  double rank(const Extended<T>& num) const {
+    inf_assert(count() > 0, "Sketch error: empty sketch.");
+    size_t below = m_neg_inf;
+    if (num.inf_sign() > 0) {
+      below = count();
+    } else if (num.finite()) {
+      for (size_t h = 0; h < m_levels.size(); ++h) {
+        for (const T val : m_levels[h]) {
+          if (!(num.raw_value() < val)) below += size_t(1) << h;
+        }
+      }
+    }
+    return static_cast<double>(below) / static_cast<double>(count());
+  }
+
+  /**
+   * REQUIRES: At least one value was recorded and 0 <= fraction <= 1.
+   * @param fraction The normalized rank.
+   * @returns Estimated value at that rank. -inf and +inf occupy the
+   * lowest and highest ranks respectively.
+   */
+  Extended<T> quantile(double fraction) const {
+    inf_assert(count() > 0, "Sketch error: empty sketch.");
+    inf_assert(0.0 <= fraction && fraction <= 1.0,
+               "Sketch error: fraction must be in [0, 1].");
+    const auto target = std::max<size_t>(
+        1, static_cast<size_t>(
+               std::ceil(fraction * static_cast<double>(count()))));
+    if (target <= m_neg_inf) return Extended<T>(INF::NEG);
+    if (target > m_neg_inf + m_finite) return Extended<T>(INF::POS);
+    size_t seen = m_neg_inf;
+    const auto items = weighted();
+    for (const auto& item : items) {
+      seen += item.second;
+      if (seen >= target) return Extended<T>(item.first);
+    }
+    return Extended<T>(items.back().first);
+  }
+};
+
+/**
+ * Streaming aggregator reporting infinity counts, moments of the finite
+ * values, and quantiles of all values.
+ */
+template <typename T>
+class StreamStats {
+ private:
+  size_t m_finite = 0;
+  size_t m_pos_inf = 0;
+  size_t m_neg_inf = 0;
+  double m_mean = 0.0;
+  double m_m2 = 0.0;
+  QuantileSketch<T> m_sketch;
+
+ public:
+  /**
+   * @param k Accuracy parameter of the quantile sketch.
+   */
+  explicit StreamStats(size_t k = 200) : m_sketch(k) {}
+
+  /**
+   * @param num The value to record.
+   */
+  void add(const Extended<T>& num) {
+    m_sketch.insert(num);
+    const int sign = num.inf_sign();
+    if (sign > 0) {
+      ++m_pos_inf;
+    } else if (sign < 0) {
+      ++m_neg_inf;
+    } else {
+      ++m_finite;
+      const auto val = static_cast<double>(num.raw_value());
+      const double delta = val - m_mean;
+      m_mean += delta / static_cast<double>(m_finite);
+      m_m2 += delta * (val - m_mean);
+    }
+  }
+
+  /**
+   * Absorbs another aggregator, for example one built on another thread.
+   * @param other The aggregator to absorb.
+   */
+  void merge(const StreamStats& other) {
+    m_sketch.merge(other.m_sketch);
+    m_pos_inf += other.m_pos_inf;
+    m_neg_inf += other.m_neg_inf;
+    if (other.m_finite == 0) return;
+    const auto count = static_cast<double>(m_finite);
+    const auto other_count = static_cast<double>(other.m_finite);
+    const double total = count + other_count;
+    const double delta = other.m_mean - m_mean;
+    m_mean += delta * other_count / total;
+    m_m2 += other.m_m2 + delta * delta * count * other_count / total;
+    m_finite += other.m_finite;
+  }
+
+  size_t count() const noexcept { return m_finite + m_pos_inf + m_neg_inf; }
+
+  size_t finite_count() const noexcept { return m_finite; }
+
+  size_t pos_inf_count() const noexcept { return m_pos_inf; }
+
+  size_t neg_inf_count() const noexcept { return m_neg_inf; }
+
+  /**
+   * REQUIRES: At least one finite value was recorded.
+   * @returns Mean of the finite values.
+   */
+  double mean() const {
+    inf_assert(m_finite > 0, "Statistics error: no finite values.");
+    return m_mean;
+  }
+
+  /**
+   * REQUIRES: At least one finite value was recorded.
+   * @returns Population variance of the finite values.
+   */
+  double variance() const {
+    inf_assert(m_finite > 0, "Statistics error: no finite values.");
+    return m_m2 / static_cast<double>(m_finite);
+  }
+
+  /**
+   * @returns Estimated value at the given normalized rank of all values.
+   */
+  Extended<T> quantile(double fraction) const {
+    return m_sketch.quantile(fraction);
+  }
+
+  /**
+   * @returns Estimated fraction of all values <= num.
+   */
+  double rank(const Extended<T>& num) const { return m_sketch.rank(num); }
+};
+}  // namespace ext
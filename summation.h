@@ -0,0 +1,140 @@
+/*
+Compensated and reproducible summation for floating point extended numbers.
+Infinite values follow operator+=: any infinity dominates, and a mix of +inf
+and -inf is an indeterminate form.
+
+Copyright 2020. Siwei Wang.
+*/
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <thread>
+#include <type_traits>
+#include <vector>
+#include "extended.h"
+#include "infinite_error.h"
+
+namespace ext {
+/**
+ * Neumaier-compensated running sum of Extended<T>.
+ */
+template <typename T>
+class CompensatedSum {
+  static_assert(std::is_floating_point_v<T>,
+                "Compensated summation requires floating point.");
+
+ private:
+  T m_sum = static_cast<T>(0);
+  T m_compensation = static_cast<T>(0);
+  bool m_pos_inf = false;
+  bool m_neg_inf = false;
+
+ public:
+  /**
+   * Adds a finite value, tracking the rounding error it causes.
+   * @param number The value to add.
+   */
+  void add(T number) noexcept {
+    const T total = m_sum + number;
+    if (std::abs(m_sum) >= std::abs(number))
+      m_compensation += (m_sum - total) + number;
+    else
+      m_compensation += (number - total) + m_sum;
+    m_sum = total;
+  }
+
+  /**
+   * Adds num. Indeterminate forms are reported by result().
+   * @param num The value to add.
+   */
+  void add(const Extended<T>& num) noexcept {
+    const int sign = num.inf_sign();
+    if (sign == 0)
+      add(num.raw_value());
+    else if (sign > 0)
+      m_pos_inf = true;
+    else
+      m_neg_inf = true;
+  }
+
+  /**
+   * Folds another partial sum into this one.
+   * @param other The partial sum to absorb.
+   */
+  void merge(const CompensatedSum& other) noexcept {
+    add(other.m_sum);
+    add(other.m_compensation);
+    m_pos_inf |= other.m_pos_inf;
+    m_neg_inf |= other.m_neg_inf;
+  }
+
+  /**
+   * THROWS: infinite_error if both +inf and -inf were added.
+   * @returns The compensated sum.
+   */
+  Extended<T> result() const {
+    if (m_pos_inf && m_neg_inf)
+      throw infinite_error("Indeterminate form: +inf + -inf");
+    if (m_pos_inf) return Extended<T>(INF::POS);
+    if (m_neg_inf) return Extended<T>(INF::NEG);
+    return Extended<T>(m_sum + m_compensation);
+  }
+};
+
+/**
+ * Sequential compensated sum.
+ * THROWS: infinite_error if nums holds both +inf and -inf.
+ * @param nums Array of sz elements.
+ * @param sz Number of elements.
+ * @returns The sum of nums.
+ */
+template <typename T>
+Extended<T> compensated_sum(const Extended<T>* nums, size_t sz) {
+  CompensatedSum<T> acc;
+  for (size_t i = 0; i < sz; ++i) acc.add(nums[i]);
+  return acc.result();
+}
+
+/**
+ * Bitwise-reproducible sum. The input is cut into fixed blocks of
+ * block_size elements that are summed independently, then the partial sums
+ * are merged in a fixed pairwise tree. Threads only decide who computes
+ * which block, so the result is identical for every thread count.
+ * THROWS: infinite_error if nums holds both +inf and -inf.
+ * @param nums Array of sz elements.
+ * @param sz Number of elements.
+ * @param threads Number of worker threads.
+ * @param block_size Elements per block. Changing it may change the result.
+ * @returns The sum of nums.
+ */
+template <typename T>
+Extended<T> reproducible_sum(const Extended<T>* nums, size_t sz,
+                             size_t threads = 1, size_t block_size = 4096) {
+  inf_assert(block_size > 0, "Summation error: block size must be positive.");
+  const size_t num_blocks = (sz + block_size - 1) / block_size;
+  std::vector<CompensatedSum<T>> partials(std::max<size_t>(num_blocks, 1));
+  const auto work = [&](size_t first_block, size_t last_block) {
+    for (size_t b = first_block; b < last_block; ++b) {
+      const size_t end = std::min(sz, (b + 1) * block_size);
+      for (size_t i = b * block_size; i < end; ++i) partials[b].add(nums[i]);
+    }
+  };
+  threads = std::max<size_t>(1, std::min(threads, num_blocks));
+  std::vector<std::thread> workers;
+  const size_t per_thread = (num_blocks + threads - 1) / threads;
+  for (size_t t = 1; t < threads; ++t) {
+    workers.emplace_back(work, std::min(num_blocks, t * per_thread),
+                         std::min(num_blocks, (t + 1) * per_thread));
+  }
+  work(0, std::min(num_blocks, per_thread));
+  for (auto& worker : workers) worker.join();
+
+  for (size_t stride = 1; stride < partials.size(); stride *= 2) {
+    for (size_t b = 0; b + stride < partials.size(); b += 2 * stride) {
+      partials[b].merge(partials[b + stride]);
+    }
+  }
+  return partials[0].result();
+}
+}  // namespace ext
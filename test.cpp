@@ -4,12 +4,49 @@ Test for extended numeric types.
 Copyright 2020. Siwei Wang.
 */
 #include "test.h"
+#include "arena.h"
+#include "arrow.h"
+#include "assignment.h"
+#include <cstring>
+#include <limits>
+#include <numeric>
+#include <functional>
 #include <sstream>
+#include <stdexcept>
+#include <thread>
 #include <string>
+#include <unordered_set>
 #include <vector>
+#include "broadcast.h"
+#include "compare.h"
+#include "compressed.h"
+#include "conformance.h"
+#include "dispatch.h"
+#include "expression.h"
 #include "extended.h"
+#include "extended_math.h"
+#include "flow.h"
+#include "fma.h"
+#include "group_by.h"
+#include "instrument.h"
+#include "interval.h"
+#include "key_encoding.h"
+#include "minplus.h"
+#include "perf_counters.h"
+#include "sparse.h"
+#include "timer_wheel.h"
+#include "statistics.h"
+#include "summation.h"
+#include "view.h"
+#include "workload.h"
+#include "zone_map.h"
+#if defined(__linux__)
+#include <sys/resource.h>
+#endif
+using std::hash;
 using std::string;
 using std::stringstream;
+using std::unordered_set;
 using std::vector;
 
 void assert(bool predicate, const char* msg) {
@@ -340,3 +377,1582 @@ void test::stream() {
   ins >> big;
   assert(big.value() == -480, "Signed stream insertion fail.");
 }
+
+void test::hashing() {
+  const hash<Extended<double>> dhash;
+  assert(dhash(Extended<double>(0.0)) == dhash(Extended<double>(-0.0)),
+         "Signed zeros hash equally.");
+  Extended<double> stale(3.5);
+  stale = INF::POS;
+  assert(dhash(stale) == dhash(Extended<double>(INF::POS)),
+         "Infinite hash ignores stale value.");
+  assert(dhash(stale) != dhash(Extended<double>(INF::NEG)),
+         "Opposite infinities hash differently.");
+
+  unordered_set<Extended<int>> set{Extended<int>(INF::NEG), Extended<int>(0),
+                                   Extended<int>(INF::POS), Extended<int>(0)};
+  assert(set.size() == 3, "Hash set deduplicates equal values.");
+  assert(set.count(Extended<int>(INF::POS)) == 1, "Hash set finds +inf.");
+
+  const vector<Extended<int16_t>> ints{
+      Extended<int16_t>(INF::NEG), Extended<int16_t>(-32768),
+      Extended<int16_t>(-1),       Extended<int16_t>(0),
+      Extended<int16_t>(255),      Extended<int16_t>(32767),
+      Extended<int16_t>(INF::POS)};
+  const vector<Extended<double>> dbls{
+      Extended<double>(INF::NEG), Extended<double>(-1e300),
+      Extended<double>(-2.5),     Extended<double>(-0.0),
+      Extended<double>(1e-300),   Extended<double>(7.0),
+      Extended<double>(INF::POS)};
+  const vector<Extended<uint32_t>> uints{
+      Extended<uint32_t>(INF::NEG), Extended<uint32_t>(0),
+      Extended<uint32_t>(256), Extended<uint32_t>(4000000000u),
+      Extended<uint32_t>(INF::POS)};
+  const auto check_order = [](const auto& nums) {
+    using T = std::decay_t<decltype(nums[0].raw_value())>;
+    constexpr auto sz = ext::key_size<T>;
+    for (size_t i = 0; i < nums.size(); ++i) {
+      unsigned char key_i[sz];
+      ext::encode_key(nums[i], key_i);
+      const auto decoded = ext::decode_key<T>(key_i);
+      assert(!(decoded < nums[i]) && !(nums[i] < decoded), "Key round trip.");
+      for (size_t j = 0; j < nums.size(); ++j) {
+        unsigned char key_j[sz];
+        ext::encode_key(nums[j], key_j);
+        const int cmp = std::memcmp(key_i, key_j, sz);
+        assert((cmp < 0) == (nums[i] < nums[j]), "Keys preserve order.");
+        assert((cmp > 0) == (nums[j] < nums[i]),
+               "Keys preserve reverse order.");
+      }
+    }
+  };
+  check_order(ints);
+  check_order(dbls);
+  check_order(uints);
+
+  unsigned char pos_zero[ext::key_size<float>];
+  unsigned char neg_zero[ext::key_size<float>];
+  ext::encode_key(Extended<float>(0.0f), pos_zero);
+  ext::encode_key(Extended<float>(-0.0f), neg_zero);
+  assert(std::memcmp(pos_zero, neg_zero, sizeof(pos_zero)) == 0,
+         "Signed zeros share a key.");
+}
+
+void test::batch_compare() {
+  vector<Extended<int32_t>> nums;
+  for (int32_t it = -100; it < 100; ++it) {
+    if (it % 17 == 0)
+      nums.emplace_back(it < 0 ? INF::NEG : INF::POS);
+    else
+      nums.emplace_back(it);
+  }
+  const size_t sz = nums.size();
+  const vector<Extended<int32_t>> scalars{
+      Extended<int32_t>(INF::NEG), Extended<int32_t>(-3), Extended<int32_t>(),
+      Extended<int32_t>(50), Extended<int32_t>(INF::POS)};
+  vector<uint64_t> lt(ext::mask_words(sz)), le(lt), eq(lt), gt(lt);
+  const auto bit = [](const vector<uint64_t>& mask, size_t i) {
+    return ((mask[i / 64] >> (i % 64)) & 1) == 1;
+  };
+  for (const auto& rhs : scalars) {
+    ext::compare_lt(nums.data(), sz, rhs, lt.data());
+    ext::compare_le(nums.data(), sz, rhs, le.data());
+    ext::compare_eq(nums.data(), sz, rhs, eq.data());
+    ext::compare_gt(nums.data(), sz, rhs, gt.data());
+    size_t expected = 0;
+    for (size_t i = 0; i < sz; ++i) {
+      assert(bit(lt, i) == (nums[i] < rhs), "Scalar lt kernel.");
+      assert(bit(le, i) == (nums[i] <= rhs), "Scalar le kernel.");
+      assert(bit(eq, i) == (nums[i] == rhs), "Scalar eq kernel.");
+      assert(bit(gt, i) == (nums[i] > rhs), "Scalar gt kernel.");
+      expected += nums[i] < rhs;
+    }
+    assert(ext::count_selected(lt.data(), sz) == expected,
+           "Selected count matches.");
+    vector<uint32_t> selection(sz);
+    const auto count = ext::to_selection(lt.data(), sz, selection.data());
+    assert(count == expected, "Selection vector size matches.");
+    for (size_t k = 0; k < count; ++k) {
+      assert(nums[selection[k]] < rhs, "Selection vector picks matches.");
+      assert(k == 0 || selection[k - 1] < selection[k],
+             "Selection vector ascends.");
+    }
+  }
+
+  vector<Extended<int32_t>> other(nums.rbegin(), nums.rend());
+  ext::compare_lt(nums.data(), other.data(), sz, lt.data());
+  ext::compare_le(nums.data(), other.data(), sz, le.data());
+  ext::compare_eq(nums.data(), other.data(), sz, eq.data());
+  ext::compare_gt(nums.data(), other.data(), sz, gt.data());
+  for (size_t i = 0; i < sz; ++i) {
+    assert(bit(lt, i) == (nums[i] < other[i]), "Array lt kernel.");
+    assert(bit(le, i) == (nums[i] <= other[i]), "Array le kernel.");
+    assert(bit(eq, i) == (nums[i] == other[i]), "Array eq kernel.");
+    assert(bit(gt, i) == (nums[i] > other[i]), "Array gt kernel.");
+  }
+
+  Extended<double> stale(-1e9);
+  stale = INF::POS;
+  uint64_t word = 0;
+  ext::compare_lt(&stale, 1, Extended<double>(0.0), &word);
+  assert(word == 0, "Stale value of infinity is ignored.");
+}
+
+void test::zone_map() {
+  ext::ZoneMap<int64_t> zones(16);
+  vector<Extended<int64_t>> mirror;
+  for (int64_t it = 0; it < 100; ++it) {
+    const Extended<int64_t> num(it < 50 ? it : 150 - it);
+    zones.append(num);
+    mirror.push_back(num);
+  }
+  assert(zones.size() == 100 && zones.num_blocks() == 7,
+         "Blocks are created on append.");
+  assert(zones.block(6).count() == 4, "Last block is partial.");
+  assert(zones.block(0).min == Extended<int64_t>(0) &&
+             zones.block(0).max == Extended<int64_t>(15),
+         "Block bounds follow appended values.");
+  assert(zones.min() == Extended<int64_t>(0) &&
+             zones.max() == Extended<int64_t>(100),
+         "Column bounds.");
+
+  const auto brute_lt = [&](const Extended<int64_t>& bound) {
+    size_t count = 0;
+    for (const auto& num : mirror) count += num < bound;
+    return count;
+  };
+  const auto brute_gt = [&](const Extended<int64_t>& bound) {
+    size_t count = 0;
+    for (const auto& num : mirror) count += bound < num;
+    return count;
+  };
+  const auto check_counts = [&]() {
+    for (const auto& bound :
+         {Extended<int64_t>(INF::NEG), Extended<int64_t>(-1),
+          Extended<int64_t>(0), Extended<int64_t>(33), Extended<int64_t>(80),
+          Extended<int64_t>(101), Extended<int64_t>(INF::POS)}) {
+      assert(zones.count_lt(bound) == brute_lt(bound), "Zone map count_lt.");
+      assert(zones.count_gt(bound) == brute_gt(bound), "Zone map count_gt.");
+    }
+  };
+  check_counts();
+  assert(zones.sum() == Extended<int64_t>(5000),
+         "Finite sum over blocks.");
+
+  zones.append(Extended<int64_t>(INF::POS));
+  mirror.emplace_back(INF::POS);
+  check_counts();
+  assert(zones.block(6).pos_inf == 1 && zones.block(6).finite == 4,
+         "Infinity counts per block.");
+  assert(zones.sum() == Extended<int64_t>(INF::POS), "Infinite sum.");
+
+  zones.append(Extended<int64_t>(INF::NEG));
+  mirror.emplace_back(INF::NEG);
+  check_counts();
+  assert(zones.min() == Extended<int64_t>(INF::NEG), "Column min is -inf.");
+  bool thrown = false;
+  try {
+    zones.sum();
+  } catch (const infinite_error&) {
+    thrown = true;
+  }
+  assert(thrown, "Indeterminate sum of +inf and -inf.");
+}
+
+/**
+ * Runs op and reports whether it threw infinite_error.
+ * @param op The operation to run.
+ * @returns Whether infinite_error was thrown.
+ */
+template <typename Op>
+bool throws_infinite(Op op) {
+  try {
+    op();
+  } catch (const infinite_error&) {
+    return true;
+  }
+  return false;
+}
+
+void test::mixed_operand() {
+  using E = Extended<int32_t>;
+  const vector<E> nums{E(INF::NEG), E(-7), E(0), E(5), E(INF::POS)};
+  for (const auto& num : nums) {
+    for (const int32_t raw : {-3, 0, 2}) {
+      const E wide(raw);
+      assert(num + raw == num + wide && raw + num == wide + num,
+             "Mixed addition matches extended addition.");
+      assert(num - raw == num - wide && raw - num == wide - num,
+             "Mixed subtraction matches extended subtraction.");
+      assert(num * raw == num * wide && raw * num == wide * num,
+             "Mixed multiplication matches extended multiplication.");
+      if (raw != 0) {
+        assert(num / raw == num / wide, "Mixed division matches.");
+      } else {
+        assert(throws_infinite([&]() { return num / raw; }),
+               "Mixed division by zero throws.");
+      }
+      if (num.finite() && num.value() == 0) {
+        assert(throws_infinite([&]() { return raw / num; }),
+               "Scalar divided by zero throws.");
+      } else {
+        assert(raw / num == wide / num, "Scalar division matches.");
+      }
+    }
+  }
+
+  Extended<double> dbl(INF::NEG);
+  dbl *= 0.0;
+  assert(dbl.finite() && close(0.0, dbl.value()),
+         "Infinity times zero is zero.");
+  assert(!(Extended<double>(INF::NEG) * -2.0 < Extended<double>(INF::POS)),
+         "Negative scale flips infinity.");
+
+  // Literals of another type convert to T rather than going through bool.
+  using L = Extended<int64_t>;
+  using D = Extended<double>;
+  const L big(6);
+  assert(big * 2 == L(12) && 2 + big == L(8) && big - 1 == L(5) &&
+             12 / big == L(2),
+         "Int literals on Extended<int64_t>.");
+  const D real(1.5);
+  assert(real * 2 == D(3.0) && 2 + real == D(3.5) && 1 - real == D(-0.5) &&
+             real / 2 == D(0.75),
+         "Int literals on Extended<double>.");
+  assert(D(INF::POS) * -1 == D(INF::NEG), "Int literal flips infinity.");
+
+  vector<E> scaled(nums), offset(nums), ys(nums.rbegin(), nums.rend());
+  ext::scale(scaled.data(), scaled.size(), -2);
+  ext::offset(offset.data(), offset.size(), 10);
+  const vector<E> ys_orig(ys);
+  bool thrown = false;
+  try {
+    ext::axpy(3, nums.data(), ys.data(), ys.size());
+  } catch (const infinite_error&) {
+    thrown = true;
+  }
+  assert(thrown, "Axpy of opposite infinities throws.");
+  for (size_t i = 0; i < nums.size(); ++i) {
+    assert(scaled[i] == nums[i] * E(-2), "Scale kernel.");
+    assert(offset[i] == nums[i] + E(10), "Offset kernel.");
+  }
+  vector<E> xs{E(1), E(2), E(INF::POS), E(0)};
+  vector<E> acc{E(5), E(INF::NEG), E(4), E(INF::POS)};
+  ext::axpy(-2, xs.data(), acc.data(), xs.size());
+  assert(acc[0] == E(3) && acc[1] == E(INF::NEG) && acc[2] == E(INF::NEG) &&
+             acc[3] == E(INF::POS),
+         "Axpy kernel.");
+}
+
+void test::expression() {
+  using E = Extended<int64_t>;
+  vector<E> a, b, c, d;
+  for (int64_t it = 0; it < 1000; ++it) {
+    a.emplace_back(it % 13 - 6);
+    b.emplace_back(it % 7 - 3);
+    c.emplace_back(it);
+    d.emplace_back(it % 5 + 1);
+  }
+  a[700] = INF::POS;
+  b[701] = INF::NEG;
+  b[700] = 0;
+  d[900] = INF::POS;
+
+  const auto fused = ext::evaluate(ext::lazy(a) * ext::lazy(b) + ext::lazy(c) -
+                                   ext::lazy(d) / E(2));
+  assert(fused.size() == a.size(), "Fused result has operand size.");
+  for (size_t i = 0; i < a.size(); ++i) {
+    assert(fused[i] == a[i] * b[i] + c[i] - d[i] / E(2),
+           "Fused expression matches chained operators.");
+  }
+
+  vector<E> in_place(c);
+  ext::evaluate(E(2) * ext::lazy(in_place) + ext::lazy(in_place),
+                in_place.data());
+  for (size_t i = 0; i < c.size(); ++i) {
+    assert(in_place[i] == E(3) * c[i], "Aliased evaluation.");
+  }
+
+  vector<E> divisor(d);
+  divisor[10] = 0;
+  assert(throws_infinite([&]() {
+           return ext::evaluate(ext::lazy(c) / ext::lazy(divisor));
+         }),
+         "Fused division by zero throws.");
+  vector<E> pos(a.size(), E(INF::POS)), neg(a.size(), E(INF::NEG));
+  assert(throws_infinite(
+             [&]() { return ext::evaluate(ext::lazy(pos) + ext::lazy(neg)); }),
+         "Fused indeterminate form throws.");
+  const vector<E> shorter(10);
+  assert(throws_infinite(
+             [&]() { return ext::lazy(shorter) + ext::lazy(a); }),
+         "Mismatched operand sizes throw.");
+}
+
+void test::fused() {
+  using E = Extended<int16_t>;
+  const vector<E> nums{E(INF::NEG), E(-3), E(0), E(2), E(INF::POS)};
+  for (const auto& a : nums) {
+    for (const auto& b : nums) {
+      for (const auto& c : nums) {
+        bool separate_thrown = false;
+        E separate;
+        try {
+          separate = a * b + c;
+        } catch (const infinite_error&) {
+          separate_thrown = true;
+        }
+        const bool fused_thrown =
+            throws_infinite([&]() { return ext::fma(a, b, c); });
+        assert(separate_thrown == fused_thrown, "Fma throws like a * b + c.");
+        if (!separate_thrown) {
+          assert(ext::fma(a, b, c) == separate, "Fma matches a * b + c.");
+        }
+      }
+    }
+  }
+
+  const double tiny = 1.0 / (1 << 30);
+  const Extended<double> lhs(1.0 + tiny), rhs(1.0 - tiny), neg_one(-1.0);
+  assert(ext::fma(lhs, rhs, neg_one).value() < 0.0,
+         "Fma rounds once for finite floating point.");
+
+  vector<Extended<int64_t>> xs, ys;
+  int64_t expected = 0;
+  for (int64_t it = 0; it < 1000; ++it) {
+    xs.emplace_back(it % 11 - 5);
+    ys.emplace_back(it % 3 + 1);
+    expected += (it % 11 - 5) * (it % 3 + 1);
+  }
+  assert(ext::dot(xs.data(), ys.data(), xs.size()) ==
+             Extended<int64_t>(expected),
+         "Finite dot product.");
+  xs[500] = INF::POS;
+  ys[500] = 0;
+  assert(ext::dot(xs.data(), ys.data(), xs.size()) ==
+             Extended<int64_t>(expected),
+         "Infinity times zero contributes zero.");
+  ys[500] = -2;
+  assert(ext::dot(xs.data(), ys.data(), xs.size()) ==
+             Extended<int64_t>(INF::NEG),
+         "Infinite product dominates dot product.");
+  xs[20] = INF::POS;
+  assert(throws_infinite(
+             [&]() { return ext::dot(xs.data(), ys.data(), xs.size()); }),
+         "Opposite infinite products throw.");
+
+  using D = Extended<double>;
+  const vector<D> mat{D(1.0), D(2.0), D(INF::POS), D(0.5), D(-1.0), D(0.0)};
+  const vector<D> vec{D(2.0), D(0.25), D(0.0)};
+  vector<D> out(2);
+  ext::gemv(mat.data(), 2, 3, vec.data(), out.data());
+  assert(close(2.5, out[0].value()) && close(0.75, out[1].value()),
+         "Matrix-vector product.");
+}
+
+void test::summation() {
+  using D = Extended<double>;
+  const vector<D> cancel{D(1e16), D(1.0), D(-1e16), D(1.0)};
+  assert(close(2.0, ext::compensated_sum(cancel.data(), cancel.size()).value()),
+         "Compensated sum recovers cancelled terms.");
+  assert(close(2.0, ext::reproducible_sum(cancel.data(), cancel.size(), 2, 1)
+                        .value()),
+         "Reproducible sum recovers cancelled terms.");
+
+  vector<D> nums;
+  double term = 1.0;
+  for (size_t it = 0; it < 100000; ++it) {
+    term = term * 1.000173 + 0.37;
+    if (term > 1e6) term -= 1e6;
+    nums.emplace_back(it % 2 ? term : -term / 3.0);
+  }
+  const auto reference =
+      ext::reproducible_sum(nums.data(), nums.size(), 1, 512);
+  for (const size_t threads : {2, 3, 7, 64}) {
+    const auto parallel =
+        ext::reproducible_sum(nums.data(), nums.size(), threads, 512);
+    const double lhs = reference.value(), rhs = parallel.value();
+    assert(std::memcmp(&lhs, &rhs, sizeof(double)) == 0,
+           "Reproducible sum is independent of thread count.");
+  }
+
+  nums[777] = INF::NEG;
+  assert(ext::reproducible_sum(nums.data(), nums.size(), 4, 512) == D(INF::NEG),
+         "Infinity dominates reproducible sum.");
+  assert(ext::compensated_sum(nums.data(), nums.size()) == D(INF::NEG),
+         "Infinity dominates compensated sum.");
+  nums[99999] = INF::POS;
+  assert(throws_infinite([&]() {
+           return ext::reproducible_sum(nums.data(), nums.size(), 4, 512);
+         }),
+         "Opposite infinities throw in reproducible sum.");
+  assert(throws_infinite(
+             [&]() { return ext::compensated_sum(nums.data(), nums.size()); }),
+         "Opposite infinities throw in compensated sum.");
+  assert(ext::reproducible_sum<double>(nullptr, 0, 4) == D(0.0),
+         "Empty sum is zero.");
+}
+
+void test::math() {
+  using D = Extended<double>;
+  const D pos_inf(INF::POS), neg_inf(INF::NEG), zero(0.0), one(1.0);
+  assert(ext::log(zero) == neg_inf && ext::log(pos_inf) == pos_inf,
+         "Logarithm limits.");
+  assert(close(1.0, ext::log(D(std::exp(1.0))).value()), "Finite log.");
+  assert(ext::exp(neg_inf) == zero && ext::exp(pos_inf) == pos_inf,
+         "Exponential limits.");
+  assert(ext::exp(D(1e6)) == pos_inf, "Exponential overflow saturates.");
+  assert(ext::sqrt(pos_inf) == pos_inf && close(3.0, ext::sqrt(D(9.0)).value()),
+         "Square root.");
+  for (const auto& bad : {D(-1.0), neg_inf}) {
+    assert(throws_infinite([&]() { return ext::log(bad); }),
+           "Log domain error.");
+    assert(throws_infinite([&]() { return ext::sqrt(bad); }),
+           "Sqrt domain error.");
+  }
+
+  assert(close(8.0, ext::pow(D(2.0), D(3.0)).value()), "Finite pow.");
+  assert(ext::pow(D(2.0), pos_inf) == pos_inf, "Growing base to +inf.");
+  assert(ext::pow(D(0.5), pos_inf) == zero, "Shrinking base to +inf.");
+  assert(ext::pow(D(0.5), neg_inf) == pos_inf, "Shrinking base to -inf.");
+  assert(ext::pow(D(-0.5), pos_inf) == zero, "Small negative base to +inf.");
+  assert(ext::pow(pos_inf, D(-2.0)) == zero, "+inf to a negative power.");
+  assert(ext::pow(neg_inf, D(3.0)) == neg_inf &&
+             ext::pow(neg_inf, D(2.0)) == pos_inf,
+         "-inf to integer powers.");
+  assert(ext::pow(pos_inf, zero) == one, "Anything to zero power is one.");
+  assert(ext::pow(D(1e200), D(2.0)) == pos_inf, "Pow overflow saturates.");
+  for (const auto& form :
+       {std::make_pair(one, pos_inf), std::make_pair(zero, neg_inf),
+        std::make_pair(neg_inf, pos_inf), std::make_pair(D(-2.0), D(0.5)),
+        std::make_pair(zero, D(-1.0)), std::make_pair(D(-2.0), pos_inf)}) {
+    assert(throws_infinite([&]() { return ext::pow(form.first, form.second); }),
+           "Pow indeterminate or domain error.");
+  }
+
+  const Extended<int> low(-5), high(5);
+  assert(ext::min(low, Extended<int>(INF::NEG)) == Extended<int>(INF::NEG) &&
+             ext::max(high, Extended<int>(INF::POS)) ==
+                 Extended<int>(INF::POS),
+         "Min and max order infinities.");
+  assert(ext::clamp(Extended<int>(INF::POS), low, high) == high &&
+             ext::clamp(Extended<int>(-9), low, high) == low &&
+             ext::clamp(Extended<int>(3), low, high) == Extended<int>(3),
+         "Clamp.");
+  assert(throws_infinite([&]() { return ext::clamp(low, high, low); }),
+         "Clamp with reversed bounds.");
+  assert(ext::abs(Extended<int>(INF::NEG)) == Extended<int>(INF::POS) &&
+             ext::abs(low) == high,
+         "Absolute value.");
+
+  vector<D> nums;
+  for (size_t it = 0; it < 600; ++it) {
+    nums.emplace_back(static_cast<double>(it) * 0.5);
+  }
+  nums[300] = pos_inf;
+  nums[0] = zero;
+  vector<D> out(nums.size());
+  using unary_t = D (*)(const D&);
+  using batch_t = void (*)(const D*, size_t, D*);
+  const vector<std::pair<unary_t, batch_t>> funcs{
+      {ext::log<double>, ext::log<double>},
+      {ext::exp<double>, ext::exp<double>},
+      {ext::sqrt<double>, ext::sqrt<double>}};
+  for (const auto& func : funcs) {
+    func.second(nums.data(), nums.size(), out.data());
+    for (size_t i = 0; i < nums.size(); ++i) {
+      assert(out[i] == func.first(nums[i]), "Batch matches scalar.");
+    }
+  }
+  ext::pow(nums.data(), nums.size(), D(1.5), out.data());
+  for (size_t i = 0; i < nums.size(); ++i) {
+    assert(out[i] == ext::pow(nums[i], D(1.5)), "Batch pow matches scalar.");
+  }
+  nums[10] = neg_inf;
+  assert(throws_infinite([&]() {
+           ext::log(nums.data(), nums.size(), out.data());
+           return 0;
+         }),
+         "Batch log domain error.");
+}
+
+void test::interval() {
+  using D = Extended<double>;
+  using I = ext::Interval<double>;
+  const vector<double> ends{-3.0, -1.5, 0.0, 0.5, 2.0};
+  vector<I> ranges;
+  for (const double low : ends) {
+    for (const double high : ends) {
+      if (low <= high) ranges.emplace_back(D(low), D(high));
+    }
+  }
+  const auto samples = [](const I& range) {
+    vector<double> points;
+    const double low = range.low().value(), high = range.high().value();
+    for (int step = 0; step <= 4; ++step) {
+      points.push_back(low + (high - low) * step / 4.0);
+    }
+    return points;
+  };
+  for (const auto& lhs : ranges) {
+    for (const auto& rhs : ranges) {
+      const auto sum = lhs + rhs, diff = lhs - rhs, prod = lhs * rhs;
+      for (const double x : samples(lhs)) {
+        for (const double y : samples(rhs)) {
+          assert(sum.contains(D(x + y)), "Interval sum contains all sums.");
+          assert(diff.contains(D(x - y)), "Interval difference contains.");
+          assert(prod.contains(D(x * y)), "Interval product contains.");
+          if (y < 0.0 || y > 0.0) {
+            assert((lhs / rhs).contains(D(x / y)),
+                   "Interval quotient contains.");
+          }
+        }
+      }
+    }
+  }
+  assert(I(D(2.0), D(3.0)) * I(D(-1.0), D(4.0)) == I(D(-3.0), D(12.0)),
+         "Product is tight.");
+
+  const D pos_inf(INF::POS), neg_inf(INF::NEG);
+  assert(I(D(0.0), D(0.0)) * I::entire() == I(D(0.0), D(0.0)),
+         "Zero times everything is zero.");
+  assert(I(D(1.0), pos_inf) * I(D(-2.0), D(-1.0)) == I(neg_inf, D(-1.0)),
+         "Half-open product.");
+  assert(I(D(1.0), D(2.0)) / I(D(0.0), D(4.0)) == I(D(0.25), pos_inf),
+         "Divisor with zero lower endpoint.");
+  assert(I(D(1.0), D(2.0)) / I(D(-4.0), D(0.0)) == I(neg_inf, D(-0.25)),
+         "Divisor with zero upper endpoint.");
+  assert(I(D(-2.0), D(-1.0)) / I(D(0.0), D(4.0)) == I(neg_inf, D(-0.25)),
+         "Negative dividend over zero lower endpoint.");
+  assert(I(D(1.0), D(2.0)) / I(D(-1.0), D(1.0)) == I::entire(),
+         "Divisor straddling zero yields the hull.");
+  assert(I(D(1.0), D(2.0)) / I(D(1.0), pos_inf) == I(D(0.0), D(2.0)),
+         "Divisor with infinite endpoint.");
+  assert(throws_infinite([]() { return I(D(1.0)) / I(D(0.0)); }),
+         "Division by [0, 0] throws.");
+  assert(throws_infinite([]() { return I(D(1.0), D(0.0)); }),
+         "Reversed endpoints throw.");
+
+  using O = ext::Interval<double, ext::Rounding::OUTWARD>;
+  const O third = O(D(1.0)) / O(D(3.0));
+  assert(third.low() < D(1.0 / 3.0) && D(1.0 / 3.0) < third.high(),
+         "Outward rounding widens endpoints.");
+  assert(third.contains(D(1.0 / 3.0)), "Outward rounding contains.");
+  // Rounding a reciprocal and then a product can lose this quotient.
+  using F = Extended<float>;
+  using OF = ext::Interval<float, ext::Rounding::OUTWARD>;
+  const OF ratio = OF(F(1.42556143f)) / OF(F(1.92542624f));
+  const double exact =
+      static_cast<double>(1.42556143f) / static_cast<double>(1.92542624f);
+  assert(static_cast<double>(ratio.low().value()) < exact &&
+             exact < static_cast<double>(ratio.high().value()),
+         "Outward quotient contains the exact quotient.");
+
+  vector<I> lhs(1000, I(D(-1.0), D(2.0))), rhs(1000, I(D(3.0), pos_inf));
+  vector<I> out(lhs.size());
+  ext::multiply(lhs.data(), rhs.data(), lhs.size(), out.data());
+  ext::add(out.data(), lhs.data(), out.size(), out.data());
+  assert(out[999] == I(neg_inf, pos_inf), "Batch propagation.");
+  ext::divide(lhs.data(), rhs.data(), lhs.size(), out.data());
+  assert(out[0] == I(D(-1.0 / 3.0), D(2.0 / 3.0)), "Batch division.");
+}
+
+void test::statistics() {
+  using D = Extended<double>;
+  constexpr size_t sz = 100000;
+  vector<D> stream;
+  for (size_t it = 0; it < sz; ++it) {
+    // Visits 0, ..., sz - 1 in a scrambled order.
+    stream.emplace_back(static_cast<double>((it * 7919) % sz));
+  }
+  for (size_t it = 0; it < 1000; ++it) stream[it * 97] = INF::NEG;
+  for (size_t it = 0; it < 500; ++it) stream[it * 97 + 13] = INF::POS;
+
+  ext::StreamStats<double> serial;
+  double sum = 0.0, sum_sq = 0.0;
+  size_t finite = 0;
+  for (const auto& num : stream) {
+    serial.add(num);
+    if (num.finite()) {
+      sum += num.value();
+      sum_sq += num.value() * num.value();
+      ++finite;
+    }
+  }
+  const double mean = sum / static_cast<double>(finite);
+  const double variance = sum_sq / static_cast<double>(finite) - mean * mean;
+  assert(serial.count() == sz && serial.neg_inf_count() == 1000 &&
+             serial.pos_inf_count() == 500 && serial.finite_count() == finite,
+         "Infinity counts.");
+  assert(close(mean, serial.mean(), 1e-6), "Welford mean.");
+  assert(close(1.0, serial.variance() / variance, 1e-9), "Welford variance.");
+
+  constexpr size_t parts = 4;
+  vector<ext::StreamStats<double>> partials(parts);
+  vector<std::thread> workers;
+  for (size_t t = 0; t < parts; ++t) {
+    workers.emplace_back([&, t]() {
+      for (size_t i = t; i < sz; i += parts) partials[t].add(stream[i]);
+    });
+  }
+  for (auto& worker : workers) worker.join();
+  for (size_t t = 1; t < parts; ++t) partials[0].merge(partials[t]);
+  auto& merged = partials[0];
+  assert(merged.count() == sz && merged.pos_inf_count() == 500,
+         "Merged counts.");
+  assert(close(mean, merged.mean(), 1e-6), "Merged mean.");
+  assert(close(1.0, merged.variance() / variance, 1e-9), "Merged variance.");
+
+  for (const auto* stats : {&serial, &merged}) {
+    assert(stats->quantile(0.0) == D(INF::NEG) &&
+               stats->quantile(0.005) == D(INF::NEG),
+           "Lowest ranks are -inf.");
+    assert(stats->quantile(1.0) == D(INF::POS) &&
+               stats->quantile(0.998) == D(INF::POS),
+           "Highest ranks are +inf.");
+    assert(close(0.01, stats->rank(D(INF::NEG))) &&
+               close(1.0, stats->rank(D(INF::POS))),
+           "Infinities rank at the extremes.");
+    for (const double fraction : {0.1, 0.25, 0.5, 0.75, 0.9}) {
+      const auto estimate = stats->quantile(fraction).value();
+      // Finite values are nearly uniform, offset by the -inf ranks.
+      const double exact = (fraction - 0.01) / 0.985 * sz;
+      assert(std::abs(estimate - exact) < 0.02 * sz, "Quantile accuracy.");
+      assert(std::abs(stats->rank(D(exact)) - fraction) < 0.02,
+             "Rank accuracy.");
+    }
+  }
+}
+
+void test::view() {
+  constexpr int64_t pos_inf = std::numeric_limits<int64_t>::max();
+  constexpr int64_t neg_inf = std::numeric_limits<int64_t>::lowest();
+  vector<int64_t> raw{3, pos_inf, -4, neg_inf, 0, 9};
+  const auto ints = ext::view(raw.data(), raw.size());
+  const vector<Extended<int64_t>> expected{
+      Extended<int64_t>(3),        Extended<int64_t>(INF::POS),
+      Extended<int64_t>(-4),       Extended<int64_t>(INF::NEG),
+      Extended<int64_t>(0),        Extended<int64_t>(9)};
+  assert(ints.size() == expected.size(), "View size.");
+  assert(std::equal(ints.begin(), ints.end(), expected.begin()),
+         "Sentinel view decodes infinities.");
+  assert(*std::min_element(ints.begin(), ints.end()) ==
+             Extended<int64_t>(INF::NEG),
+         "Algorithms run over views.");
+  assert(ints.end() - ints.begin() == 6 && ints.begin()[2] == expected[2],
+         "Random access iterator.");
+
+  raw[3] = 1;
+  assert(ext::sum(ints) == Extended<int64_t>(INF::POS), "View sum with inf.");
+  raw[1] = -1;
+  assert(ext::sum(ints) == Extended<int64_t>(8), "View sum on buffer.");
+  assert(std::accumulate(ints.begin(), ints.end(), Extended<int64_t>()) ==
+             Extended<int64_t>(8),
+         "Accumulate over view.");
+
+  const vector<int32_t> custom{-1, 7, 100};
+  const auto sentinels = ext::view(custom.data(), custom.size(), 100, -1);
+  assert(sentinels[0] == Extended<int32_t>(INF::NEG) &&
+             sentinels[2] == Extended<int32_t>(INF::POS),
+         "Custom sentinels.");
+  constexpr uint32_t umax = std::numeric_limits<uint32_t>::max();
+  const vector<uint32_t> unsigned_raw{0, umax, umax - 1, 5};
+  const auto unsigned_view =
+      ext::view(unsigned_raw.data(), unsigned_raw.size(), umax, umax - 1);
+  assert(unsigned_view[0] == Extended<uint32_t>(0) &&
+             unsigned_view[1] == Extended<uint32_t>(INF::POS) &&
+             unsigned_view[2] == Extended<uint32_t>(INF::NEG),
+         "Unsigned sentinels keep 0 finite.");
+
+  const double huge = std::numeric_limits<double>::infinity();
+  const vector<double> dbls{1.5, -huge, 2.5};
+  const auto floats = ext::view(dbls.data(), dbls.size());
+  assert(floats[1] == Extended<double>(INF::NEG) && !floats.finite(1) &&
+             floats[2] == Extended<double>(2.5),
+         "IEEE view maps infinities.");
+  assert(ext::sum(floats) == Extended<double>(INF::NEG), "IEEE view sum.");
+
+  const vector<int16_t> values{5, -2, 3, 0, 8, 1, 1, 1, 4};
+  const vector<uint8_t> bitmap{0xF5, 0x01};  // Elements 1 and 3 are infinite.
+  const auto masked = ext::masked_view(values.data(), bitmap.data(), 9);
+  assert(masked[1] == Extended<int16_t>(INF::NEG) &&
+             masked[3] == Extended<int16_t>(INF::POS) &&
+             masked[8] == Extended<int16_t>(4),
+         "Validity bitmap view.");
+  assert(throws_infinite([&]() { return ext::sum(masked); }),
+         "Opposite infinities in view sum throw.");
+}
+
+void test::arrow() {
+  using E = Extended<int32_t>;
+  const vector<E> ints{E(4), E(INF::NEG), E(-9), E(INF::POS), E(0)};
+  ArrowArray array;
+  ArrowSchema schema;
+  ext::export_column(ints, &array, &schema);
+  assert(string(schema.format) == "+s" && schema.n_children == 2 &&
+             string(schema.children[0]->format) == "i" &&
+             string(schema.children[1]->name) == "inf",
+         "Integer columns export as a struct with a side buffer.");
+  assert(string(schema.metadata + 8, 20) == "ARROW:extension:name",
+         "Extension type metadata.");
+  assert(array.length == 5 && array.n_children == 2,
+         "Exported array shape.");
+  const auto* signs = static_cast<const int8_t*>(array.children[1]->buffers[1]);
+  assert(signs[1] == -1 && signs[3] == 1 && signs[0] == 0,
+         "Infinity side buffer.");
+  {
+    const auto imported = ext::import_column<int32_t>(&array, &schema);
+    assert(array.release == nullptr, "Import takes ownership.");
+    assert(std::equal(ints.begin(), ints.end(), imported.view().begin()),
+           "Integer round trip.");
+  }
+  schema.release(&schema);
+  assert(schema.release == nullptr, "Schema release.");
+
+  using D = Extended<double>;
+  const vector<D> dbls{D(1.5), D(INF::POS), D(INF::NEG), D(-0.25)};
+  ext::export_column(dbls, &array, &schema);
+  assert(string(schema.format) == "g" && array.n_buffers == 2,
+         "Floating point columns export as plain arrays.");
+  const auto* values = static_cast<const double*>(array.buffers[1]);
+  assert(values[1] > std::numeric_limits<double>::max() &&
+             values[2] < std::numeric_limits<double>::lowest(),
+         "Infinities export as IEEE infinities.");
+  const auto doubles = ext::import_column<double>(&array, &schema);
+  schema.release(&schema);
+  for (size_t i = 0; i < dbls.size(); ++i) {
+    assert(doubles[i] == dbls[i], "Floating point round trip.");
+  }
+
+  // Arrays from other producers are imported in place, honoring offsets.
+  static bool released = false;
+  static const double buffer[] = {9.0, 2.0,
+                                  -std::numeric_limits<double>::infinity()};
+  static const void* buffers[] = {nullptr, buffer};
+  ArrowArray foreign{};
+  foreign.length = 2;
+  foreign.offset = 1;
+  foreign.n_buffers = 2;
+  foreign.buffers = buffers;
+  foreign.release = [](ArrowArray* arr) {
+    released = true;
+    arr->release = nullptr;
+  };
+  ArrowSchema foreign_schema{};
+  foreign_schema.format = "g";
+  foreign_schema.release = [](ArrowSchema* sch) { sch->release = nullptr; };
+  assert(throws_infinite([&]() {
+           return ext::import_column<float>(&foreign, &foreign_schema);
+         }),
+         "Mismatched format throws.");
+  {
+    const auto column = ext::import_column<double>(&foreign, &foreign_schema);
+    assert(column.size() == 2 && column[0] == D(2.0) &&
+               column[1] == D(INF::NEG),
+           "Foreign import with offset.");
+    assert(column.view().data() == buffer + 1, "Import does not copy.");
+  }
+  assert(released, "Imported column releases its array.");
+}
+
+void test::compressed() {
+  using E = Extended<int16_t>;
+  using Column = ext::CompressedColumn<int16_t>;
+  vector<E> nums(2500);
+  for (size_t i = 0; i < nums.size(); ++i) {
+    nums[i] = E(static_cast<int16_t>(100 + static_cast<int>(i % 37) * 3));
+  }
+  // The second block holds the extremes of int16_t, needing the full width.
+  nums[1100] = E(std::numeric_limits<int16_t>::lowest());
+  nums[1101] = E(std::numeric_limits<int16_t>::max());
+  nums[7] = E(INF::POS);
+  nums[2400] = E(INF::POS);
+  const Column column(nums.data(), nums.size());
+  assert(column.size() == 2500 && column.num_blocks() == 3, "Block layout.");
+  assert(column.bytes() < nums.size() * sizeof(int16_t),
+         "Compressed column is smaller than the primitive array.");
+  for (size_t i = 0; i < nums.size(); ++i) {
+    assert(column[i] == nums[i], "Random access.");
+  }
+  assert(column.decompress() == nums, "Round trip.");
+  assert(column.sum() == E(INF::POS), "Infinite sum.");
+
+  int16_t buffer[Column::BLOCK];
+  assert(column.decompress_block(2, buffer) == 452 &&
+             E(buffer[0]) == nums[2048] && E(buffer[451]) == nums[2499],
+         "Block decompression.");
+
+  nums[7] = E(INF::NEG);
+  assert(throws_infinite([&]() {
+           return Column(nums.data(), nums.size()).sum();
+         }),
+         "Opposite infinities throw.");
+  nums[7] = nums[2400] = E(3);
+  int16_t expected = 0;
+  for (const auto& num : nums) {
+    expected = static_cast<int16_t>(expected + num.value());
+  }
+  assert(Column(nums.data(), nums.size()).sum() == E(expected),
+         "Finite sum wraps like int16_t.");
+
+  const vector<Extended<uint64_t>> wide{
+      Extended<uint64_t>(0), Extended<uint64_t>(INF::NEG),
+      Extended<uint64_t>(std::numeric_limits<uint64_t>::max())};
+  const ext::CompressedColumn<uint64_t> wide_column(wide.data(), wide.size());
+  assert(wide_column.decompress() == wide, "Full width offsets.");
+  const vector<Extended<int8_t>> empty;
+  assert(ext::CompressedColumn<int8_t>(empty.data(), 0).sum() ==
+             Extended<int8_t>(0),
+         "Empty column.");
+}
+
+void test::sparse() {
+  using E = Extended<int32_t>;
+  using Sparse = ext::SparseInfArray<int32_t>;
+  const vector<E> lhs_nums{E(3), E(INF::POS), E(-2), E(0), E(INF::NEG), E(7)};
+  const vector<E> rhs_nums{E(1), E(4), E(INF::POS), E(INF::NEG), E(2), E(-1)};
+  Sparse lhs(lhs_nums.data(), lhs_nums.size());
+  const Sparse rhs(rhs_nums.data(), rhs_nums.size());
+  assert(lhs.size() == 6 && lhs.inf_count() == 2 && lhs.data()[1] == 0,
+         "Sparse layout.");
+  assert(lhs.to_extended() == lhs_nums, "Sparse round trip.");
+  assert(lhs.min() == E(INF::NEG) && rhs.max() == E(INF::POS),
+         "Reductions settle infinities from the index.");
+
+  vector<E> expected(lhs_nums.size());
+  for (size_t i = 0; i < expected.size(); ++i) {
+    expected[i] = lhs_nums[i] * rhs_nums[i];
+  }
+  const auto product = lhs * rhs;
+  assert(product.to_extended() == expected && product.inf_count() == 3,
+         "Elementwise product merges the indexes.");
+  Sparse opposite(rhs);
+  opposite.set(4, E(INF::POS));
+  assert(throws_infinite([&]() { return lhs + opposite; }),
+         "Opposite infinities throw.");
+  assert(lhs.to_extended() == lhs_nums, "A throw leaves the array unchanged.");
+
+  lhs.set(1, E(5));
+  lhs.set(4, E(INF::POS));
+  lhs.set(0, E(INF::POS));
+  assert(lhs.inf_positions() == vector<size_t>({0, 4}) && lhs[1] == E(5),
+         "Point updates keep the index sorted.");
+  lhs.set(0, E(-6));
+  lhs.set(4, E(-6));
+  assert(lhs.inf_count() == 0 && lhs.sum() == E(-2) && lhs.min() == E(-6) &&
+             lhs.max() == E(7),
+         "Finite reductions run the primitive loop.");
+  const auto diff = rhs - Sparse(rhs_nums.size());
+  assert(diff.to_extended() == rhs_nums, "Subtracting zeros.");
+  Sparse scaled(rhs);
+  scaled *= -2;
+  assert(scaled[2] == E(INF::NEG) && scaled[5] == E(2), "Negative scale.");
+  scaled *= 0;
+  assert(scaled.inf_count() == 0 && scaled.sum() == E(0), "0 * inf == 0.");
+  const vector<E> infinite{E(INF::POS), E(INF::POS)};
+  assert(Sparse(infinite.data(), 2).min() == E(INF::POS),
+         "All infinite minimum.");
+}
+
+void test::group_by() {
+  using E = Extended<int32_t>;
+  vector<int16_t> keys;
+  vector<E> values;
+  for (int i = 0; i < 5000; ++i) {
+    keys.push_back(static_cast<int16_t>((i * 7919) % 301 - 150));
+    values.push_back(E(i % 23 - 11));
+  }
+  values[10] = E(INF::POS);
+  values[20] = E(INF::NEG);
+  keys[20] = keys[10];
+  values[30] = E(INF::NEG);
+
+  const auto serial = ext::group_by(keys.data(), values.data(), keys.size());
+  const auto parallel =
+      ext::group_by(keys.data(), values.data(), keys.size(), 3);
+  assert(serial.size() == 301 && parallel.size() == 301, "Group count.");
+  for (size_t g = 0; g < serial.size(); ++g) {
+    const auto key = serial[g].key;
+    const auto& agg = serial[g].aggregate;
+    E sum, least(INF::POS), greatest(INF::NEG);
+    size_t count = 0, infinite = 0;
+    bool throws = false;
+    for (size_t i = 0; i < keys.size(); ++i) {
+      if (keys[i] != key) continue;
+      ++count;
+      infinite += !values[i].finite();
+      least = std::min(least, values[i]);
+      greatest = std::max(greatest, values[i]);
+      try {
+        sum += values[i];
+      } catch (const infinite_error&) {
+        throws = true;
+      }
+    }
+    assert(agg.count() == count && agg.inf_count() == infinite &&
+               agg.min() == least && agg.max() == greatest,
+           "Group counts and extremes.");
+    assert(agg.indeterminate() == throws, "Indeterminate groups.");
+    assert(throws || agg.sum() == sum, "Group sums.");
+    const auto& other = parallel[g].aggregate;
+    assert(parallel[g].key == key && other.count() == count &&
+               other.indeterminate() == throws &&
+               (throws || other.sum() == sum),
+           "Parallel build agrees.");
+  }
+  const auto bad = ext::indeterminate_keys(serial);
+  assert(bad == vector<int16_t>{keys[10]}, "Indeterminate keys.");
+  assert(throws_infinite([&]() {
+           const auto it = std::find_if(
+               serial.begin(), serial.end(),
+               [&](const auto& group) { return group.key == keys[10]; });
+           return it->aggregate.sum();
+         }),
+         "Indeterminate sums throw on request.");
+  assert(ext::group_by(keys.data(), values.data(), 0, 4).empty(),
+         "No rows.");
+}
+
+void test::dispatch() {
+  using E = Extended<int64_t>;
+  vector<E> nums(3000);
+  for (size_t i = 0; i < nums.size(); ++i) {
+    nums[i] = E(static_cast<int64_t>(i % 17) - 8);
+  }
+  vector<E> infinite(nums);
+  infinite[2500] = E(INF::NEG);
+  const E sum = std::accumulate(nums.begin(), nums.end(), E());
+  const E product =
+      std::accumulate(nums.begin(), nums.end(), E(1), std::multiplies<E>());
+  vector<E> nonzero;
+  for (const auto& num : nums) {
+    if (num) nonzero.push_back(num);
+  }
+  const auto finite = nonzero;
+  const E finite_product = std::accumulate(
+      finite.begin(), finite.end(), E(1), std::multiplies<E>());
+  nonzero[5] = E(INF::POS);
+  E inf_product(1);
+  for (const auto& num : nonzero) inf_product *= num;
+
+  const int64_t raw[] = {5, std::numeric_limits<int64_t>::max(), -3,
+                         std::numeric_limits<int64_t>::lowest()};
+  const string text = " 12\t-inf\n+inf  -7 inf ";
+  const vector<E> parsed_expected{E(12), E(INF::NEG), E(INF::POS), E(-7),
+                                  E(INF::POS)};
+  for (int level = 0; level <= static_cast<int>(ext::detected_isa());
+       ++level) {
+    ext::force_isa(static_cast<ext::Isa>(level));
+    const auto& kernels = ext::kernels<int64_t>();
+    assert(kernels.sum(nums.data(), nums.size()) == sum &&
+               kernels.sum(infinite.data(), infinite.size()) == E(INF::NEG),
+           "Dispatched sum.");
+    assert(kernels.product(nums.data(), nums.size()) == product &&
+               kernels.product(finite.data(), finite.size()) ==
+                   finite_product &&
+               kernels.product(nonzero.data(), nonzero.size()) ==
+                   inf_product,
+           "Dispatched product.");
+    vector<uint64_t> mask(ext::mask_words(nums.size()));
+    kernels.compare_lt(nums.data(), nums.size(), E(0), mask.data());
+    size_t negatives = 0;
+    for (const auto& num : nums) negatives += num < E(0);
+    assert(ext::count_selected(mask.data(), nums.size()) == negatives,
+           "Dispatched compare.");
+    E converted[4];
+    kernels.convert(raw, 4, converted);
+    assert(converted[0] == E(5) && converted[1] == E(INF::POS) &&
+               converted[3] == E(INF::NEG),
+           "Dispatched convert.");
+    E parsed[8];
+    assert(kernels.parse(text.data(), text.size(), parsed, 8) == 5 &&
+               std::equal(parsed_expected.begin(), parsed_expected.end(),
+                          parsed),
+           "Dispatched parse.");
+    assert(kernels.parse(text.data(), text.size(), parsed, 2) == 2,
+           "Parse stops at capacity.");
+  }
+  ext::reset_isa();
+  assert(ext::active_isa() == ext::detected_isa(), "Reset dispatch.");
+  if (ext::detected_isa() != ext::Isa::AVX512) {
+    bool rejected = false;
+    try {
+      ext::force_isa(ext::Isa::AVX512);
+    } catch (const std::invalid_argument&) {
+      rejected = true;
+    }
+    assert(rejected && ext::active_isa() == ext::detected_isa(),
+           "Unsupported level is rejected.");
+  }
+  const string bad = "4 4x";
+  E parsed[2];
+  assert(throws_infinite([&]() {
+           return ext::kernels<int64_t>().parse(bad.data(), bad.size(),
+                                                parsed, 2);
+         }),
+         "Malformed numbers throw.");
+  const string dbls = "0.5 -inf 2.25";
+  Extended<double> reals[3];
+  assert(ext::kernels<double>().parse(dbls.data(), dbls.size(), reals, 3) ==
+                 3 &&
+             reals[0] == Extended<double>(0.5) &&
+             reals[2] == Extended<double>(2.25),
+         "Parse floating point.");
+}
+
+void test::perf_counters() {
+  // Which counters open depends on the machine, so only consistency holds.
+  PerfCounters counters;
+  bool any = false;
+  for (size_t e = 0; e < PerfCounters::NUM_EVENTS; ++e) {
+    const auto event = static_cast<PerfCounters::Event>(e);
+    any = any || counters.available(event);
+    assert(string(PerfCounters::name(event)) != "unknown", "Event names.");
+    assert(counters.value(event) == 0, "Counts start at zero.");
+  }
+  assert(counters.available() == any, "Any counter available.");
+  counters.start();
+  volatile uint64_t work = 0;
+  for (uint64_t i = 0; i < 100000; ++i) work = work + i;
+  counters.stop();
+  for (size_t e = 0; e < PerfCounters::NUM_EVENTS; ++e) {
+    const auto event = static_cast<PerfCounters::Event>(e);
+    assert(counters.available(event) || counters.value(event) == 0,
+           "Unavailable counters read zero.");
+  }
+#if defined(__linux__)
+  // With no file descriptors to spare, perf_event_open fails for every
+  // counter, as it does where the kernel forbids counting.
+  rlimit limit;
+  assert(getrlimit(RLIMIT_NOFILE, &limit) == 0, "Read descriptor limit.");
+  rlimit none = limit;
+  none.rlim_cur = 0;
+  assert(setrlimit(RLIMIT_NOFILE, &none) == 0, "Drop descriptor limit.");
+  PerfCounters starved;
+  setrlimit(RLIMIT_NOFILE, &limit);
+  assert(!starved.available(), "No counters without descriptors.");
+  starved.start();
+  starved.stop();
+  for (size_t e = 0; e < PerfCounters::NUM_EVENTS; ++e) {
+    assert(starved.value(static_cast<PerfCounters::Event>(e)) == 0,
+           "Unopened counters read zero.");
+  }
+#endif
+}
+
+void test::arena() {
+  using E = Extended<int64_t>;
+  E uninit(UNINIT);
+  uninit = E(INF::NEG);
+  assert(uninit == E(INF::NEG), "Uninitialized construction.");
+
+  ext::Arena arena(1 << 20);
+  assert(arena.bytes_reserved() == 0, "Arenas map lazily.");
+  const auto* small = static_cast<char*>(arena.allocate(3, 1));
+  const auto* aligned = static_cast<char*>(arena.allocate(8, 64));
+  assert(reinterpret_cast<uintptr_t>(aligned) % 64 == 0 &&
+             aligned >= small + 3,
+         "Aligned bump allocation.");
+  assert(arena.bytes_reserved() == ext::Arena::HUGE_PAGE,
+         "Chunks round up to huge pages.");
+  assert(reinterpret_cast<uintptr_t>(small) % ext::Arena::HUGE_PAGE == 0,
+         "Chunks are huge page aligned.");
+  assert(throws_infinite([&]() { return arena.allocate(8, 8192); }) &&
+             throws_infinite([&]() { return arena.allocate(8, 24); }),
+         "Alignment is checked.");
+  {
+    ext::ArenaVector<int64_t> nums(5000, ext::ArenaAllocator<E>(arena));
+    ext::parallel_fill(nums.data(), nums.size(), E(7), 3);
+    assert(std::all_of(nums.begin(), nums.end(),
+                       [](const E& num) { return num == E(7); }),
+           "Parallel fill.");
+    nums.push_back(E(INF::POS));
+    nums.resize(nums.size() + 2);
+    nums.back() = E(1);
+    assert(nums[5000] == E(INF::POS) && nums.size() == 5003,
+           "Growth preserves elements.");
+    const ext::ArenaVector<int64_t> copies(3, E(2), nums.get_allocator());
+    assert(copies[2] == E(2) && copies.get_allocator() == nums.get_allocator(),
+           "Construction from a value.");
+  }
+  const auto* big = static_cast<E*>(arena.allocate(sizeof(E) << 20, 16));
+  assert(big && arena.bytes_reserved() > (sizeof(E) << 20),
+         "Oversized requests get their own chunk.");
+  arena.reset();
+  assert(arena.bytes_used() == 0 && arena.bytes_reserved() == 0, "Reset.");
+}
+
+void test::timer_wheel() {
+  using std::chrono::milliseconds;
+  using std::chrono::nanoseconds;
+  using Deadline = Extended<nanoseconds>;
+  const Deadline never(INF::POS);
+  const Deadline soon(milliseconds(5));
+  assert(soon + Deadline(milliseconds(2)) == Deadline(milliseconds(7)) &&
+             -Deadline(INF::POS) == Deadline(INF::NEG) && soon < never &&
+             never + soon == never,
+         "Extended durations.");
+  assert(throws_infinite([&]() { return never - never; }),
+         "Indeterminate durations throw.");
+
+  ext::TimerWheel wheel(milliseconds(1));
+  vector<int> fired;
+  const auto record = [&fired](int tag) {
+    return [&fired, tag]() { fired.push_back(tag); };
+  };
+  const auto unscheduled = wheel.schedule(never, record(0));
+  wheel.schedule(Deadline(INF::NEG), record(1));
+  assert(wheel.size() == 0 && fired == vector<int>{1} &&
+             !wheel.cancel(unscheduled),
+         "+inf is never scheduled and -inf fires at once.");
+  wheel.schedule(Deadline(milliseconds(300)), record(4));
+  wheel.schedule(Deadline(nanoseconds(1500000)), record(2));
+  const auto cancelled = wheel.schedule(Deadline(milliseconds(3)), record(9));
+  wheel.schedule(Deadline(milliseconds(70000)), record(5));
+  wheel.schedule(Deadline(milliseconds(40)), [&]() {
+    fired.push_back(3);
+    wheel.schedule(Deadline(milliseconds(10)), record(6));
+  });
+  assert(wheel.size() == 5 && wheel.cancel(cancelled) &&
+             !wheel.cancel(cancelled) && wheel.size() == 4,
+         "Cancellation.");
+  assert(wheel.advance(milliseconds(1)) == 0 &&
+             wheel.advance(milliseconds(2)) == 1 && fired.back() == 2,
+         "Deadlines round up to ticks.");
+  // The 40ms callback schedules a deadline that has passed, so it fires.
+  assert(wheel.advance(milliseconds(299)) == 1 && fired.back() == 6 &&
+             wheel.advance(milliseconds(300)) == 1 && fired.back() == 4,
+         "Firing across levels.");
+  assert(wheel.advance(milliseconds(69999)) == 0 &&
+             wheel.advance(milliseconds(80000)) == 1 &&
+             fired == vector<int>({1, 2, 3, 6, 4, 5}) && wheel.size() == 0,
+         "Cascades from higher levels.");
+  assert(wheel.now() == milliseconds(80000), "Current time.");
+
+  // Ids are reused but stale handles stay stale.
+  const auto first = wheel.schedule(Deadline(milliseconds(80001)), record(7));
+  wheel.advance(milliseconds(80001));
+  const auto second = wheel.schedule(Deadline(milliseconds(80002)), record(8));
+  assert(!wheel.cancel(first) && wheel.cancel(second), "Stale handles.");
+  vector<int64_t> times;
+  for (int64_t i = 0; i < 3000; ++i) {
+    const auto when = (i * 7919 * 7919) % 5000000 + 80003;
+    wheel.schedule(Deadline(milliseconds(when)),
+                   [&times, when]() { times.push_back(when); });
+  }
+  wheel.advance(milliseconds(6000000));
+  assert(times.size() == 3000 && std::is_sorted(times.begin(), times.end()),
+         "Timers fire in deadline order.");
+  assert(throws_infinite([]() { return ext::TimerWheel(nanoseconds(0)); }),
+         "Tick must be positive.");
+}
+
+void test::max_flow() {
+  using E = Extended<int32_t>;
+  using Network = ext::FlowNetwork<int32_t>;
+  // Checks conservation, capacities and that a minimum cut matches value.
+  const auto valid = [](const Network& net, const vector<E>& caps,
+                        const vector<std::pair<size_t, size_t>>& ends,
+                        size_t source, size_t sink, const E& value) {
+    vector<E> balance(net.num_nodes());
+    for (size_t e = 0; e < caps.size(); ++e) {
+      if (net.flow(e) < E(0) || caps[e] < net.flow(e)) return false;
+      balance[ends[e].first] -= net.flow(e);
+      balance[ends[e].second] += net.flow(e);
+    }
+    for (size_t u = 0; u < balance.size(); ++u) {
+      if (u != source && u != sink && balance[u] != E(0)) return false;
+    }
+    const auto side = net.min_cut(source);
+    E cut;
+    for (size_t e = 0; e < caps.size(); ++e) {
+      if (side[ends[e].first] && !side[ends[e].second]) cut += caps[e];
+    }
+    return balance[sink] == value && cut == value && !side[sink];
+  };
+
+  // Classic six node network with maximum flow 23.
+  vector<std::pair<size_t, size_t>> ends{{0, 1}, {0, 2}, {1, 2}, {2, 1},
+                                         {1, 3}, {3, 2}, {2, 4}, {4, 3},
+                                         {3, 5}, {4, 5}};
+  vector<E> caps{E(16), E(13), E(10), E(4), E(12),
+                 E(9),  E(14), E(7),  E(20), E(4)};
+  Network net(6);
+  for (size_t e = 0; e < ends.size(); ++e) {
+    net.add_edge(ends[e].first, ends[e].second, caps[e]);
+  }
+  assert(net.dinic(0, 5) == E(23) && valid(net, caps, ends, 0, 5, E(23)),
+         "Dinic maximum flow.");
+  assert(net.push_relabel(0, 5) == E(23) &&
+             valid(net, caps, ends, 0, 5, E(23)),
+         "Push-relabel maximum flow.");
+
+  // Uncuttable edges route flow without ever forming +inf - +inf.
+  ends.push_back({0, 3});
+  caps.push_back(E(INF::POS));
+  ends.push_back({1, 4});
+  caps.push_back(E(INF::POS));
+  net.add_edge(0, 3, E(INF::POS));
+  net.add_edge(1, 4, E(INF::POS));
+  assert(net.dinic(0, 5) == E(24) && valid(net, caps, ends, 0, 5, E(24)),
+         "Dinic with infinite capacities.");
+  assert(net.push_relabel(0, 5) == E(24) &&
+             valid(net, caps, ends, 0, 5, E(24)),
+         "Push-relabel with infinite capacities.");
+  net.add_edge(3, 5, E(INF::POS));
+  assert(net.dinic(0, 5) == E(INF::POS) &&
+             net.push_relabel(0, 5) == E(INF::POS),
+         "Unbounded flow.");
+
+  // Random layered networks with a sprinkling of infinite edges.
+  for (uint32_t seed = 1; seed <= 20; ++seed) {
+    uint32_t state = seed;
+    const auto next = [&state]() {
+      state = state * 1103515245u + 12345u;
+      return (state >> 16) & 0x7fff;
+    };
+    const size_t nodes = 30;
+    Network random(nodes);
+    vector<std::pair<size_t, size_t>> rand_ends;
+    vector<E> rand_caps;
+    for (size_t e = 0; e < 120; ++e) {
+      const size_t from = next() % (nodes - 1);
+      const size_t span = std::min<size_t>(5, nodes - 1 - from);
+      const size_t to = from + 1 + next() % span;
+      const E cap = next() % 10 == 0 ? E(INF::POS) : E(next() % 50);
+      rand_ends.push_back({from, to});
+      rand_caps.push_back(cap);
+      random.add_edge(from, to, cap);
+    }
+    const E by_dinic = random.dinic(0, nodes - 1);
+    const bool dinic_valid = !by_dinic.finite() ||
+                             valid(random, rand_caps, rand_ends, 0,
+                                   nodes - 1, by_dinic);
+    const E by_push = random.push_relabel(0, nodes - 1);
+    const bool push_valid = !by_push.finite() ||
+                            valid(random, rand_caps, rand_ends, 0,
+                                  nodes - 1, by_push);
+    assert(by_dinic == by_push && dinic_valid && push_valid,
+           "Solvers agree on random networks.");
+  }
+  assert(throws_infinite([&]() { return net.add_edge(0, 1, E(-1)); }) &&
+             throws_infinite([&]() { return net.dinic(2, 2); }),
+         "Invalid networks throw.");
+}
+
+void test::assignment() {
+  using E = Extended<int32_t>;
+  const E forbidden(INF::POS);
+  // Brute force over every permutation, skipping forbidden entries.
+  const auto best = [](const vector<E>& costs, size_t n) {
+    vector<size_t> perm(n);
+    std::iota(perm.begin(), perm.end(), 0);
+    E lowest(INF::POS);
+    do {
+      E total;
+      for (size_t i = 0; i < n; ++i) total += costs[i * n + perm[i]];
+      lowest = std::min(lowest, total);
+    } while (std::next_permutation(perm.begin(), perm.end()));
+    return lowest;
+  };
+  // A valid result is a permutation whose entries sum to its cost.
+  const auto valid = [](const ext::Assignment<int32_t>& result,
+                        const vector<E>& costs, size_t n) {
+    if (!result.feasible()) return result.column_of.empty();
+    vector<char> taken(n, 0);
+    E total;
+    for (size_t i = 0; i < n; ++i) {
+      const size_t j = result.column_of[i];
+      if (taken[j] || !costs[i * n + j].finite()) return false;
+      taken[j] = 1;
+      total += costs[i * n + j];
+    }
+    return total == result.cost;
+  };
+
+  const vector<E> costs{E(4), E(1), E(3), E(2), E(0), E(5), E(3), E(2), E(2)};
+  const auto by_hungarian = ext::hungarian(costs.data(), 3);
+  const auto by_auction = ext::auction(costs.data(), 3, 2);
+  assert(by_hungarian.cost == E(5) && valid(by_hungarian, costs, 3) &&
+             by_auction.cost == E(5) && valid(by_auction, costs, 3),
+         "Optimal assignment.");
+
+  // The cheap entries are forbidden, so a big-M would be picked.
+  const vector<E> masked{forbidden, E(1), E(9), forbidden};
+  assert(ext::hungarian(masked.data(), 2).cost == E(10) &&
+             ext::auction(masked.data(), 2).cost == E(10),
+         "Forbidden entries are never selected.");
+  const vector<E> blocked{E(1), forbidden, E(2), forbidden};
+  assert(!ext::hungarian(blocked.data(), 2).feasible() &&
+             !ext::auction(blocked.data(), 2).feasible(),
+         "Infeasible assignment.");
+
+  // Random matrices against brute force, some of them infeasible.
+  uint32_t state = 7;
+  const auto next = [&state]() {
+    state = state * 1103515245u + 12345u;
+    return (state >> 16) & 0x7fff;
+  };
+  for (size_t trial = 0; trial < 200; ++trial) {
+    const size_t n = 1 + trial % 7;
+    vector<E> random(n * n);
+    for (auto& cost : random) {
+      cost = next() % 3 == 0 ? forbidden
+                             : E(static_cast<int32_t>(next() % 100) - 20);
+    }
+    const E expected = best(random, n);
+    const auto hung = ext::hungarian(random.data(), n);
+    const auto auct = ext::auction(random.data(), n, 2);
+    assert(hung.cost == expected && valid(hung, random, n) &&
+               auct.cost == expected && valid(auct, random, n),
+           "Solvers match brute force.");
+  }
+}
+
+void test::minplus() {
+  using E = Extended<int64_t>;
+  const E pos_inf(INF::POS), neg_inf(INF::NEG);
+  // Quadratic reference with +inf entries as absent terms.
+  const auto reference = [&](const vector<E>& a, const vector<E>& b) {
+    vector<E> c(a.size() + b.size() - 1, pos_inf);
+    for (size_t i = 0; i < a.size(); ++i) {
+      for (size_t j = 0; j < b.size(); ++j) {
+        if (a[i] != pos_inf && b[j] != pos_inf) {
+          c[i + j] = std::min(c[i + j], a[i] + b[j]);
+        }
+      }
+    }
+    return c;
+  };
+  const auto convolve = [](const vector<E>& a, const vector<E>& b) {
+    return ext::minplus_convolve(a.data(), a.size(), b.data(), b.size());
+  };
+
+  const vector<E> knapsack{pos_inf, E(3), E(1), pos_inf};
+  const vector<E> item{E(0), E(5)};
+  assert(convolve(knapsack, item) ==
+             vector<E>({pos_inf, E(3), E(1), E(6), pos_inf}),
+         "Leading and trailing +inf are absent terms.");
+  assert(convolve(vector<E>{E(2), pos_inf, E(-1)}, vector<E>{neg_inf}) ==
+             vector<E>({neg_inf, pos_inf, neg_inf}),
+         "Interior infinities.");
+  assert(convolve(vector<E>{pos_inf}, item) == vector<E>(2, pos_inf) &&
+             convolve(vector<E>(), item).empty(),
+         "No terms.");
+
+  // Random convex, concave and arbitrary shapes in every pairing.
+  uint32_t state = 3;
+  const auto next = [&state]() {
+    state = state * 1103515245u + 12345u;
+    return static_cast<int64_t>((state >> 16) & 0x7fff);
+  };
+  const auto make = [&](size_t shape, size_t sz) {
+    vector<int64_t> steps(sz);
+    for (auto& step : steps) step = next() % 200 - 100;
+    if (shape == 0) std::sort(steps.begin(), steps.end());
+    if (shape == 1) std::sort(steps.rbegin(), steps.rend());
+    vector<E> nums(sz);
+    int64_t value = next() % 1000;
+    for (size_t i = 0; i < sz; ++i) {
+      value += steps[i];
+      nums[i] = shape == 2 ? E(next() % 1000) : E(value);
+    }
+    // Pad with +inf runs, and sometimes an interior one.
+    nums.insert(nums.begin(), static_cast<size_t>(next() % 3), pos_inf);
+    nums.insert(nums.end(), static_cast<size_t>(next() % 3), pos_inf);
+    if (shape == 3) nums[nums.size() / 2] = pos_inf;
+    return nums;
+  };
+  for (size_t trial = 0; trial < 400; ++trial) {
+    const auto a = make(trial % 4, 1 + static_cast<size_t>(next() % 40));
+    const auto b = make(trial / 4 % 4, 1 + static_cast<size_t>(next() % 40));
+    assert(convolve(a, b) == reference(a, b), "Matches the reference.");
+  }
+  // Longer than a block, through the general kernel.
+  const auto long_a = make(2, 3000), long_b = make(2, 700);
+  assert(convolve(long_a, long_b) == reference(long_a, long_b),
+         "Blocked kernel matches the reference.");
+}
+
+void test::conformance() {
+  const size_t threads = std::max(1u, std::thread::hardware_concurrency());
+  const auto builtin = [](ext::Op op, auto& lhs, const auto& rhs) {
+    ext::apply(op, lhs, rhs);
+  };
+  const auto signed_report = ext::check_conformance<int8_t>(builtin, threads);
+  const auto unsigned_report =
+      ext::check_conformance<uint8_t>(builtin, threads);
+  // 258 values squared, times 10 operators.
+  assert(signed_report.checked + signed_report.skipped == 665640 &&
+             unsigned_report.checked + unsigned_report.skipped == 665640,
+         "Every pair and operator is enumerated.");
+  assert(!signed_report.mismatches && !unsigned_report.mismatches,
+         "Compound operators conform to the reference model.");
+
+  // Bulk kernels at every level must agree on pairs.
+  for (int level = 0; level <= static_cast<int>(ext::detected_isa());
+       ++level) {
+    ext::force_isa(static_cast<ext::Isa>(level));
+    const auto bulk = [](ext::Op op, Extended<int8_t>& lhs,
+                         const Extended<int8_t>& rhs) {
+      const Extended<int8_t> pair[] = {lhs, rhs};
+      if (op == ext::Op::ADD) {
+        lhs = ext::kernels<int8_t>().sum(pair, 2);
+      } else if (op == ext::Op::MUL) {
+        lhs = ext::kernels<int8_t>().product(pair, 2);
+      } else {
+        ext::apply(op, lhs, rhs);
+      }
+    };
+    assert(!ext::check_conformance<int8_t>(bulk, threads).mismatches,
+           "Bulk kernels conform to the reference model.");
+  }
+  ext::reset_isa();
+
+  // A fast path that forgets 0 * inf = 0 is caught and reported.
+  const auto broken = [](ext::Op op, Extended<int8_t>& lhs,
+                         const Extended<int8_t>& rhs) {
+    if (op == ext::Op::MUL && !rhs.finite()) {
+      lhs = rhs;
+    } else {
+      ext::apply(op, lhs, rhs);
+    }
+  };
+  const auto report = ext::check_conformance<int8_t>(broken, threads);
+  // Negative, zero and -inf left operands, each times both infinities.
+  assert(report.mismatches == (128 + 1 + 1) * 2 &&
+             report.first_mismatch == "-128 *= +inf: expected -inf, got +inf",
+         "Mismatches are counted and described.");
+}
+
+void test::instrument() {
+  using E = Extended<int32_t>;
+  const auto count = [](const ext::OpCounts& counts, ext::Op op, int lhs,
+                        int rhs) {
+    return counts.ops[static_cast<size_t>(op)][lhs + 1][rhs + 1];
+  };
+  ext::reset_counts();
+  const auto work = [](size_t) {
+    E num(5);
+    for (int i = 0; i < 1000; ++i) num += E(1);
+    num *= E(INF::POS);
+    num -= 3;
+    throws_infinite([&num]() { return num + E(INF::NEG); });
+  };
+  vector<std::thread> workers;
+  for (size_t t = 1; t < 4; ++t) workers.emplace_back(work, t);
+  work(0);
+  for (auto& worker : workers) worker.join();
+  const auto counts = ext::collect_counts();
+  if constexpr (ext::INSTRUMENTED) {
+    // Counts of exited threads are kept.
+    assert(count(counts, ext::Op::ADD, 0, 0) == 4000 &&
+               count(counts, ext::Op::MUL, 0, 1) == 4 &&
+               count(counts, ext::Op::SUB, 1, 0) == 4 &&
+               count(counts, ext::Op::ADD, 1, -1) == 4 &&
+               counts.total() == 4012 && counts.errors == 4,
+           "Operations are counted per operand kind.");
+    const string text = ext::format_counts(counts, ext::CountFormat::TEXT);
+    assert(text.find("finite += finite: 4000\n") != string::npos &&
+               text.find("errors: 4\n") != string::npos,
+           "Text format.");
+  } else {
+    assert(counts.total() == 0 && counts.errors == 0,
+           "Disabled hooks count nothing.");
+  }
+  const string prometheus =
+      ext::format_counts(counts, ext::CountFormat::PROMETHEUS);
+  assert(prometheus.find("# TYPE extended_operations_total counter\n") !=
+                 string::npos &&
+             prometheus.find("extended_operations_total{op=\"<<=\","
+                             "lhs=\"-inf\",rhs=\"+inf\"} 0\n") !=
+                 string::npos &&
+             prometheus.find("extended_errors_total ") != string::npos,
+         "Prometheus format has every series.");
+  ext::reset_counts();
+  assert(ext::collect_counts().total() == 0, "Counters reset.");
+}
+
+void test::workload() {
+  using ext::Distribution;
+  // Several chunks, so threads split the work.
+  const size_t sz = 300000;
+  ext::WorkloadConfig config;
+  config.seed = 42;
+  config.inf_density = 0.2;
+  config.inf_run_length = 16;
+  const auto serial = ext::generate_extended<int32_t>(sz, config);
+  assert(serial == ext::generate_extended<int32_t>(sz, config, 4),
+         "Output does not depend on the thread count.");
+  config.seed = 43;
+  assert(serial != ext::generate_extended<int32_t>(sz, config),
+         "Seeds change the output.");
+  config.seed = 42;
+
+  // Infinite density and clustering are close to the configuration.
+  size_t infinite = 0, negative = 0, runs = 0;
+  for (size_t i = 0; i < sz; ++i) {
+    if (serial[i].finite()) {
+      assert(serial[i] >= Extended<int32_t>(-1000) &&
+                 serial[i] <= Extended<int32_t>(1000),
+             "Uniform values stay in range.");
+      continue;
+    }
+    ++infinite;
+    negative += serial[i] < Extended<int32_t>();
+    runs += i == 0 || serial[i - 1].finite();
+  }
+  const auto share =
+      static_cast<double>(infinite) / static_cast<double>(sz);
+  const auto run_length =
+      static_cast<double>(infinite) / static_cast<double>(runs);
+  assert(share > 0.18 && share < 0.22 && run_length > 14 &&
+             run_length < 18 && negative > infinite / 3 &&
+             negative < infinite * 2 / 3,
+         "Infinity density and run length.");
+  const auto values = ext::generate_numbers<int32_t>(sz, config);
+  bool same = true;
+  for (size_t i = 0; i < sz; ++i) {
+    same &= !serial[i].finite() || serial[i].value() == values[i];
+  }
+  assert(same, "Infinities do not shift the finite values.");
+
+  // Each distribution over a couple of types.
+  config.inf_density = 0;
+  config.distribution = Distribution::NORMAL;
+  config.mean = 10;
+  config.stddev = 2;
+  const auto normal = ext::generate_numbers<double>(sz, config, 2);
+  const double mean = std::accumulate(normal.begin(), normal.end(), 0.0) /
+                      static_cast<double>(sz);
+  assert(std::abs(mean - 10) < 0.05, "Normal mean.");
+  config.distribution = Distribution::ZIPF;
+  config.min = 1;
+  const auto zipf = ext::generate_numbers<uint16_t>(sz, config);
+  const auto ones = std::count(zipf.begin(), zipf.end(), uint16_t(1));
+  const auto twos = std::count(zipf.begin(), zipf.end(), uint16_t(2));
+  assert(*std::max_element(zipf.begin(), zipf.end()) <= 1000 &&
+             ones > twos * 17 / 10 && ones < twos * 23 / 10,
+         "Zipf ranks.");
+  config.distribution = Distribution::CLUSTERED;
+  config.min = -100;
+  config.max = 100;
+  const auto clustered = ext::generate_numbers<int8_t>(sz, config);
+  size_t changes = 0;
+  for (size_t i = 1; i < sz; ++i) changes += clustered[i] != clustered[i - 1];
+  assert(changes > sz / 100 && changes < sz / 50, "Clustered runs.");
+
+  config.inf_density = 1;
+  for (const double inf_run : {1.0, 8.0}) {
+    config.inf_run_length = inf_run;
+    const auto all_inf = ext::generate_extended<int>(sz, config);
+    assert(std::none_of(all_inf.begin(), all_inf.end(),
+                        [](const Extended<int>& num) { return num.finite(); }),
+           "Density 1 is all infinite.");
+  }
+  config.inf_density = 0.9;
+  config.inf_run_length = 1;
+  assert(throws_infinite(
+             [&]() { return ext::generate_extended<int>(10, config); }),
+         "Unreachable density throws.");
+}
@@ -14,6 +14,31 @@ void add_subtract();
 void multiply_divide();
 void finite_ops();
 void stream();
+void hashing();
+void batch_compare();
+void zone_map();
+void mixed_operand();
+void expression();
+void fused();
+void summation();
+void math();
+void interval();
+void statistics();
+void view();
+void arrow();
+void compressed();
+void sparse();
+void group_by();
+void dispatch();
+void perf_counters();
+void arena();
+void timer_wheel();
+void max_flow();
+void assignment();
+void minplus();
+void conformance();
+void instrument();
+void workload();
 }  // namespace test
 
 class test_error : public std::exception {
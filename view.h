@@ -0,0 +1,294 @@
+/*
+Non-owning views presenting primitive buffers as ranges of Extended<T>.
+Floating point buffers map native IEEE infinities, integer buffers map
+chosen sentinel values, and any buffer can pair with a validity bitmap.
+
+Copyright 2020. Siwei Wang.
+*/
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <type_traits>
+#include "extended.h"
+#include "infinite_error.h"
+
+namespace ext {
+// ENCODINGS
+// Each decodes element idx of a buffer and reports whether it is finite.
+
+/**
+ * Native IEEE infinities of floating point buffers.
+ */
+template <typename T>
+struct IeeeEncoding {
+  static_assert(std::is_floating_point_v<T>,
+                "IEEE encoding requires floating point.");
+
+  bool finite(const T* data, size_t idx) const noexcept {
+    return !std::isinf(data[idx]);
+  }
+
+  Extended<T> decode(const T* data, size_t idx) const noexcept {
+    const T raw = data[idx];
+    if (!std::isinf(raw)) return Extended<T>(raw);
+    return Extended<T>(raw > 0 ? INF::POS : INF::NEG);
+  }
+};
+
+/**
+ * Sentinel values standing for the infinities, by default the extremes of T.
+ * Unsigned T has no negative extreme, so both sentinels must be given.
+ */
+template <typename T>
+struct SentinelEncoding {
+  static_assert(std::is_integral_v<T>,
+                "Sentinel encoding requires integers. Use IeeeEncoding.");
+
+  static constexpr T default_neg_inf() noexcept {
+    static_assert(std::is_signed_v<T>,
+                  "Unsigned buffers need explicit sentinels, as 0 is lowest.");
+    return std::numeric_limits<T>::lowest();
+  }
+
+  T pos_inf = std::numeric_limits<T>::max();
+  T neg_inf = default_neg_inf();
+
+  bool finite(const T* data, size_t idx) const noexcept {
+    return (data[idx] != pos_inf) & (data[idx] != neg_inf);
+  }
+
+  Extended<T> decode(const T* data, size_t idx) const noexcept {
+    const T raw = data[idx];
+    if (raw == pos_inf) return Extended<T>(INF::POS);
+    if (raw == neg_inf) return Extended<T>(INF::NEG);
+    return Extended<T>(raw);
+  }
+};
+
+/**
+ * Arrow-style validity bitmap: bit idx (least significant bit first) set
+ * means finite. A cleared bit is -inf if the stored value is negative and
+ * +inf otherwise.
+ */
+template <typename T>
+struct MaskEncoding {
+  const uint8_t* bitmap;
+
+  bool finite(const T*, size_t idx) const noexcept {
+    return (bitmap[idx / 8] >> (idx % 8)) & 1;
+  }
+
+  Extended<T> decode(const T* data, size_t idx) const noexcept {
+    if (finite(data, idx)) return Extended<T>(data[idx]);
+    if constexpr (std::is_signed_v<T>) {
+      if (data[idx] < 0) return Extended<T>(INF::NEG);
+    }
+    return Extended<T>(INF::POS);
+  }
+};
+
+/**
+ * Read-only random-access range of Extended<T> over a T buffer.
+ */
+template <typename T, typename Encoding>
+class ExtendedView {
+ private:
+  const T* m_data;
+  size_t m_size;
+  Encoding m_encoding;
+
+ public:
+  using value_type = Extended<T>;
+
+  /**
+   * Random-access proxy iterator: elements are decoded on the fly, so
+   * dereferencing yields a value rather than a reference into the buffer,
+   * much like std::vector<bool>. It moves and compares as a random-access
+   * iterator, but taking the address of *it or binding a non-const
+   * reference to it does not work.
+   */
+  class iterator {
+   private:
+    const ExtendedView* m_view;
+    size_t m_idx;
+
+   public:
+    using iterator_category = std::random_access_iterator_tag;
+    using value_type = Extended<T>;
+    using difference_type = std::ptrdiff_t;
+    using pointer = void;
+    using reference = Extended<T>;
+
+    iterator() noexcept : m_view(nullptr), m_idx(0) {}
+    iterator(const ExtendedView* view, size_t idx) noexcept
+        : m_view(view), m_idx(idx) {}
+
+    reference operator*() const noexcept { return (*m_view)[m_idx]; }
+    reference operator[](difference_type off) const noexcept {
+      return *(*this + off);
+    }
+
+    iterator& operator++() noexcept {
+      ++m_idx;
+      return *this;
+    }
+    iterator operator++(int) noexcept {
+      const auto tmp(*this);
+      ++m_idx;
+      return tmp;
+    }
+    iterator& operator--() noexcept {
+      --m_idx;
+      return *this;
+    }
+    iterator operator--(int) noexcept {
+      const auto tmp(*this);
+      --m_idx;
+      return tmp;
+    }
+    iterator& operator+=(difference_type off) noexcept {
+      m_idx = static_cast<size_t>(static_cast<difference_type>(m_idx) + off);
+      return *this;
+    }
+    iterator& operator-=(difference_type off) noexcept {
+      return *this += -off;
+    }
+    friend iterator operator+(iterator it, difference_type off) noexcept {
+      return it += off;
+    }
+    friend iterator operator+(difference_type off, iterator it) noexcept {
+      return it += off;
+    }
+    friend iterator operator-(iterator it, difference_type off) noexcept {
+      return it -= off;
+    }
+    friend difference_type operator-(const iterator& lhs,
+                                     const iterator& rhs) noexcept {
+      return static_cast<difference_type>(lhs.m_idx) -
+             static_cast<difference_type>(rhs.m_idx);
+    }
+
+    friend bool operator==(const iterator& lhs, const iterator& rhs) noexcept {
+      return lhs.m_idx == rhs.m_idx;
+    }
+    friend bool operator!=(const iterator& lhs, const iterator& rhs) noexcept {
+      return lhs.m_idx != rhs.m_idx;
+    }
+    friend bool operator<(const iterator& lhs, const iterator& rhs) noexcept {
+      return lhs.m_idx < rhs.m_idx;
+    }
+    friend bool operator>(const iterator& lhs, const iterator& rhs) noexcept {
+      return rhs < lhs;
+    }
+    friend bool operator<=(const iterator& lhs, const iterator& rhs) noexcept {
+      return !(rhs < lhs);
+    }
+    friend bool operator>=(const iterator& lhs, const iterator& rhs) noexcept {
+      return !(lhs < rhs);
+    }
+  };
+
+  ExtendedView(const T* data, size_t sz, Encoding encoding = Encoding())
+      : m_data(data), m_size(sz), m_encoding(encoding) {}
+
+  size_t size() const noexcept { return m_size; }
+
+  const T* data() const noexcept { return m_data; }
+
+  const Encoding& encoding() const noexcept { return m_encoding; }
+
+  Extended<T> operator[](size_t idx) const noexcept {
+    return m_encoding.decode(m_data, idx);
+  }
+
+  bool finite(size_t idx) const noexcept {
+    return m_encoding.finite(m_data, idx);
+  }
+
+  iterator begin() const noexcept { return iterator(this, 0); }
+
+  iterator end() const noexcept { return iterator(this, m_size); }
+};
+
+// FACTORIES
+
+/**
+ * @returns A view using IEEE infinities for floating point buffers and the
+ * extremes of T as sentinels for signed integer buffers. Unsigned buffers
+ * must name their sentinels.
+ */
+template <typename T>
+auto view(const T* data, size_t sz) {
+  if constexpr (std::is_floating_point_v<T>) {
+    return ExtendedView<T, IeeeEncoding<T>>(data, sz);
+  } else {
+    return ExtendedView<T, SentinelEncoding<T>>(data, sz);
+  }
+}
+
+/**
+ * @returns A view of an integer buffer where pos_inf and neg_inf are
+ * sentinels for the infinities.
+ */
+template <typename T>
+ExtendedView<T, SentinelEncoding<T>> view(
+    const T* data, size_t sz, T pos_inf, T neg_inf) {
+  inf_assert(pos_inf != neg_inf, "View error: sentinels must differ.");
+  return ExtendedView<T, SentinelEncoding<T>>(
+      data, sz, SentinelEncoding<T>{pos_inf, neg_inf});
+}
+
+/**
+ * @returns A view of any buffer whose finiteness is given by bitmap.
+ */
+template <typename T>
+ExtendedView<T, MaskEncoding<T>> masked_view(const T* data,
+                                             const uint8_t* bitmap,
+                                             size_t sz) {
+  return ExtendedView<T, MaskEncoding<T>>(data, sz, MaskEncoding<T>{bitmap});
+}
+
+// REDUCTIONS
+
+/**
+ * Sum with the rules of operator+=. Blocks without infinities are summed
+ * on the primitive buffer directly.
+ * THROWS: infinite_error if the view holds both +inf and -inf.
+ * @param nums The view to reduce.
+ * @returns The sum of all elements.
+ */
+template <typename T, typename Encoding>
+Extended<T> sum(const ExtendedView<T, Encoding>& nums) {
+  constexpr size_t BLOCK = 1024;
+  const T* data = nums.data();
+  T total = static_cast<T>(0);
+  bool pos_inf = false, neg_inf = false;
+  for (size_t begin = 0; begin < nums.size(); begin += BLOCK) {
+    const size_t end = std::min(nums.size(), begin + BLOCK);
+    bool finite = true;
+    for (size_t i = begin; i < end; ++i) finite &= nums.finite(i);
+    if (finite) {
+      for (size_t i = begin; i < end; ++i) {
+        total = static_cast<T>(total + data[i]);
+      }
+      continue;
+    }
+    for (size_t i = begin; i < end; ++i) {
+      const auto num = nums[i];
+      const int sign = num.inf_sign();
+      if (sign == 0) total = static_cast<T>(total + num.raw_value());
+      pos_inf |= sign > 0;
+      neg_inf |= sign < 0;
+    }
+  }
+  if (pos_inf && neg_inf)
+    throw infinite_error("Indeterminate form: +inf + -inf");
+  if (pos_inf) return Extended<T>(INF::POS);
+  if (neg_inf) return Extended<T>(INF::NEG);
+  return Extended<T>(total);
+}
+}  // namespace ext
@@ -0,0 +1,247 @@
+/*
+Seeded synthetic workloads for benchmarking Extended<T>. Values come from a
+uniform, normal, Zipf or clustered distribution, and infinities can be
+mixed in at a given density, scattered or in runs. Output depends only on
+the configuration, never on the thread count, so runs are reproducible.
+
+Copyright 2020. Siwei Wang.
+*/
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <thread>
+#include <type_traits>
+#include <vector>
+#include "extended.h"
+#include "infinite_error.h"
+
+namespace ext {
+enum class Distribution { UNIFORM, NORMAL, ZIPF, CLUSTERED };
+
+struct WorkloadConfig {
+  Distribution distribution = Distribution::UNIFORM;
+  uint64_t seed = 0;
+  // UNIFORM and CLUSTERED draw from [min, max]. ZIPF yields min + rank - 1
+  // for ranks 1 to zipf_ranks. Integer types round down.
+  double min = -1000;
+  double max = 1000;
+  // NORMAL, rounded to nearest for integer types.
+  double mean = 0;
+  double stddev = 1;
+  // ZIPF: P(rank) is proportional to rank^-zipf_exponent.
+  double zipf_exponent = 1;
+  size_t zipf_ranks = 1000;
+  // CLUSTERED: mean length of runs of one repeated value.
+  double run_length = 64;
+  // Fraction of entries that are infinite.
+  double inf_density = 0;
+  // Fraction of infinite runs that are -inf.
+  double neg_inf_share = 0.5;
+  // Mean length of infinite runs, 1 for scattered infinities.
+  double inf_run_length = 1;
+};
+
+namespace detail {
+// Elements per independently seeded chunk, the unit of parallel work.
+constexpr size_t WORKLOAD_CHUNK = size_t(1) << 16;
+
+/**
+ * SplitMix64, which is fast, passes BigCrush and seeds cheaply per chunk.
+ * Its output is the same everywhere, unlike std distributions.
+ */
+class SplitMix {
+  uint64_t m_state;
+
+ public:
+  explicit SplitMix(uint64_t seed) noexcept : m_state(seed) {}
+
+  uint64_t next() noexcept {
+    uint64_t z = (m_state += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+  }
+
+  /**
+   * @returns Uniform double in [0, 1).
+   */
+  double unit() noexcept {
+    return static_cast<double>(next() >> 11) * 0x1.0p-53;
+  }
+
+  bool chance(double probability) noexcept { return unit() < probability; }
+};
+
+/**
+ * Converts to T, clamping integer types to their range.
+ */
+template <typename T>
+T narrow(double x) noexcept {
+  if constexpr (std::is_integral_v<T>) {
+    const auto lowest = static_cast<double>(std::numeric_limits<T>::lowest());
+    // The largest double below 2^digits, which converts back exactly.
+    const double highest =
+        std::nextafter(static_cast<double>(std::numeric_limits<T>::max()) + 1,
+                       0.0);
+    return static_cast<T>(std::min(std::max(x, lowest), highest));
+  } else {
+    return static_cast<T>(x);
+  }
+}
+
+/**
+ * Fills one chunk. Runs restart at chunk boundaries.
+ */
+template <typename T>
+void fill_chunk(const WorkloadConfig& config, const std::vector<double>& cdf,
+                size_t chunk, T* values, int8_t* signs, size_t sz) {
+  SplitMix gen(config.seed ^ SplitMix(chunk).next());
+  // Infinities draw from their own stream, so values match with or without
+  // them. Infinite runs follow a two state Markov chain whose stationary
+  // share of infinite entries is inf_density.
+  SplitMix inf_gen(gen.next());
+  // At density 1 no run ends, so every entry is infinite.
+  const double leave = config.inf_density >= 1 ? 0 : 1 / config.inf_run_length;
+  const double enter = config.inf_density >= 1
+                           ? 1
+                           : config.inf_density * leave /
+                                 (1 - config.inf_density);
+  const auto draw_sign = [&]() -> int8_t {
+    return inf_gen.chance(config.neg_inf_share) ? -1 : 1;
+  };
+  int8_t sign = inf_gen.chance(config.inf_density) ? draw_sign() : 0;
+  const double width = std::is_integral_v<T> ? config.max - config.min + 1
+                                             : config.max - config.min;
+  const auto uniform = [&]() {
+    const double x = config.min + gen.unit() * width;
+    return narrow<T>(std::is_integral_v<T> ? std::floor(x) : x);
+  };
+  T run_value = uniform();
+  for (size_t i = 0; i < sz; ++i) {
+    switch (config.distribution) {
+      case Distribution::UNIFORM:
+        values[i] = uniform();
+        break;
+      case Distribution::NORMAL: {
+        // Box-Muller, using one of the pair.
+        const double radius = std::sqrt(-2 * std::log(1 - gen.unit()));
+        const double x = config.mean + config.stddev * radius *
+                                           std::cos(6.283185307179586 *
+                                                    gen.unit());
+        values[i] = narrow<T>(std::is_integral_v<T> ? std::round(x) : x);
+        break;
+      }
+      case Distribution::ZIPF: {
+        // Index of the drawn rank, guarding against rounding in the cdf.
+        const auto index = std::min(
+            static_cast<size_t>(
+                std::upper_bound(cdf.begin(), cdf.end(), gen.unit()) -
+                cdf.begin()),
+            cdf.size() - 1);
+        values[i] = narrow<T>(config.min + static_cast<double>(index));
+        break;
+      }
+      case Distribution::CLUSTERED:
+        if (i && gen.chance(1 / config.run_length)) run_value = uniform();
+        values[i] = run_value;
+        break;
+    }
+    if (signs) {
+      if (i) {
+        if (sign) {
+          if (inf_gen.chance(leave)) sign = 0;
+        } else if (inf_gen.chance(enter)) {
+          sign = draw_sign();
+        }
+      }
+      signs[i] = sign;
+    }
+  }
+}
+
+/**
+ * Runs fill_chunk over every chunk, chunk c on thread c % threads.
+ */
+template <typename T>
+void fill_workload(size_t sz, const WorkloadConfig& config, size_t threads,
+                   T* values, int8_t* signs) {
+  inf_assert(config.min <= config.max && config.stddev >= 0 &&
+                 config.zipf_ranks > 0 && config.run_length >= 1 &&
+                 config.inf_run_length >= 1,
+             "Workload error: invalid configuration.");
+  inf_assert(config.inf_density >= 1 ||
+                 config.inf_density <=
+                     config.inf_run_length / (config.inf_run_length + 1),
+             "Workload error: infinity density too high for the run length.");
+  std::vector<double> cdf;
+  if (config.distribution == Distribution::ZIPF) {
+    cdf.resize(config.zipf_ranks);
+    double total = 0;
+    for (size_t r = 0; r < cdf.size(); ++r) {
+      total += std::pow(static_cast<double>(r + 1), -config.zipf_exponent);
+      cdf[r] = total;
+    }
+    for (double& p : cdf) p /= total;
+  }
+  const size_t chunks = (sz + WORKLOAD_CHUNK - 1) / WORKLOAD_CHUNK;
+  threads = std::max<size_t>(1, std::min(threads, chunks));
+  const auto work = [&](size_t t) {
+    for (size_t c = t; c < chunks; c += threads) {
+      const size_t begin = c * WORKLOAD_CHUNK;
+      fill_chunk(config, cdf, c, values + begin,
+                 signs ? signs + begin : nullptr,
+                 std::min(WORKLOAD_CHUNK, sz - begin));
+    }
+  };
+  std::vector<std::thread> workers;
+  for (size_t t = 1; t < threads; ++t) workers.emplace_back(work, t);
+  work(0);
+  for (auto& worker : workers) worker.join();
+}
+}  // namespace detail
+
+/**
+ * THROWS: infinite_error on an invalid configuration.
+ * @param sz Number of values.
+ * @param config Distribution and seed. Infinity settings are ignored.
+ * @param threads Number of worker threads, which never changes the output.
+ * @returns sz values of type T.
+ */
+template <typename T>
+std::vector<T> generate_numbers(size_t sz, const WorkloadConfig& config,
+                                size_t threads = 1) {
+  std::vector<T> values(sz);
+  detail::fill_workload(sz, config, threads, values.data(), nullptr);
+  return values;
+}
+
+/**
+ * Same values as generate_numbers, with infinities mixed in.
+ * THROWS: infinite_error on an invalid configuration, or an inf_density
+ * above inf_run_length / (inf_run_length + 1) other than 1.
+ * @param sz Number of values.
+ * @param config Distribution, seed and infinity settings.
+ * @param threads Number of worker threads, which never changes the output.
+ * @returns sz extended values of type T.
+ */
+template <typename T>
+std::vector<Extended<T>> generate_extended(size_t sz,
+                                           const WorkloadConfig& config,
+                                           size_t threads = 1) {
+  std::vector<T> values(sz);
+  std::vector<int8_t> signs(sz);
+  detail::fill_workload(sz, config, threads, values.data(), signs.data());
+  std::vector<Extended<T>> nums(sz);
+  for (size_t i = 0; i < sz; ++i) {
+    if (signs[i]) {
+      nums[i] = Extended<T>(signs[i] > 0 ? INF::POS : INF::NEG);
+    } else {
+      nums[i] = Extended<T>(values[i]);
+    }
+  }
+  return nums;
+}
+}  // namespace ext
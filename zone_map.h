@@ -0,0 +1,221 @@
+/*
+Zone maps for columns of extended numbers.
+Each fixed-size block keeps its min, max, and counts of finite and infinite
+values so range predicates and reductions can skip whole blocks.
+
+Copyright 2020. Siwei Wang.
+*/
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "compare.h"
+#include "extended.h"
+#include "infinite_error.h"
+
+namespace ext {
+/**
+ * Metadata of one block, ordered the same way as operator<.
+ */
+template <typename T>
+struct BlockSummary {
+  Extended<T> min{INF::POS};
+  Extended<T> max{INF::NEG};
+  size_t pos_inf = 0;
+  size_t neg_inf = 0;
+  size_t finite = 0;
+
+  /**
+   * @returns Number of elements in the block.
+   */
+  size_t count() const noexcept { return pos_inf + neg_inf + finite; }
+
+  /**
+   * @returns Whether the block holds only finite values.
+   */
+  bool all_finite() const noexcept { return pos_inf == 0 && neg_inf == 0; }
+
+  /**
+   * Folds num into this summary.
+   * @param num The appended value.
+   */
+  void add(const Extended<T>& num) noexcept {
+    if (num < min) min = num;
+    if (max < num) max = num;
+    const int sign = num.inf_sign();
+    pos_inf += sign > 0;
+    neg_inf += sign < 0;
+    finite += sign == 0;
+  }
+};
+
+/**
+ * Append-only column of extended numbers with per-block summaries.
+ */
+template <typename T>
+class ZoneMap {
+ private:
+  std::vector<Extended<T>> m_data;
+  std::vector<BlockSummary<T>> m_blocks;
+  size_t m_block_size;
+
+  /**
+   * Counts elements of a partially qualifying block with a batch kernel.
+   * @param block_idx Index of the block.
+   * @param bound The scalar to compare against.
+   * @param less Whether to count elements below rather than above bound.
+   */
+  size_t scan(size_t block_idx, const Extended<T>& bound, bool less) const {
+    const size_t sz = m_blocks[block_idx].count();
+    const auto* nums = m_data.data() + block_idx * m_block_size;
+    std::vector<uint64_t> mask(mask_words(sz));
+    if (less)
+      compare_lt(nums, sz, bound, mask.data());
+    else
+      compare_gt(nums, sz, bound, mask.data());
+    return count_selected(mask.data(), sz);
+  }
+
+ public:
+  /**
+   * Empty column.
+   * @param block_size Number of elements summarized per block.
+   */
+  explicit ZoneMap(size_t block_size = 4096) : m_block_size(block_size) {
+    inf_assert(block_size > 0, "Zone map error: block size must be positive.");
+  }
+
+  // APPEND
+
+  /**
+   * Appends num and updates the summary of the last block.
+   * @param num The value to append.
+   */
+  void append(const Extended<T>& num) {
+    if (m_data.size() % m_block_size == 0) m_blocks.emplace_back();
+    m_data.push_back(num);
+    m_blocks.back().add(num);
+  }
+
+  /**
+   * Appends sz values in order.
+   * @param nums Array of sz values.
+   * @param sz Number of values.
+   */
+  void append(const Extended<T>* nums, size_t sz) {
+    m_data.reserve(m_data.size() + sz);
+    for (size_t i = 0; i < sz; ++i) append(nums[i]);
+  }
+
+  // ACCESS
+
+  size_t size() const noexcept { return m_data.size(); }
+
+  size_t block_size() const noexcept { return m_block_size; }
+
+  size_t num_blocks() const noexcept { return m_blocks.size(); }
+
+  const Extended<T>& operator[](size_t idx) const { return m_data[idx]; }
+
+  const Extended<T>* data() const noexcept { return m_data.data(); }
+
+  /**
+   * @param block_idx Index of the block.
+   * @returns Summary of elements [block_idx * block_size(), ...).
+   */
+  const BlockSummary<T>& block(size_t block_idx) const {
+    return m_blocks[block_idx];
+  }
+
+  // QUERIES
+
+  /**
+   * REQUIRES: The column is not empty.
+   * @returns The least element.
+   */
+  Extended<T> min() const {
+    inf_assert(!m_blocks.empty(), "Zone map error: empty column.");
+    Extended<T> least(INF::POS);
+    for (const auto& blk : m_blocks) {
+      if (blk.min < least) least = blk.min;
+    }
+    return least;
+  }
+
+  /**
+   * REQUIRES: The column is not empty.
+   * @returns The greatest element.
+   */
+  Extended<T> max() const {
+    inf_assert(!m_blocks.empty(), "Zone map error: empty column.");
+    Extended<T> greatest(INF::NEG);
+    for (const auto& blk : m_blocks) {
+      if (greatest < blk.max) greatest = blk.max;
+    }
+    return greatest;
+  }
+
+  /**
+   * Counts elements less than bound, skipping blocks whose min >= bound
+   * and counting blocks whose max < bound without a scan.
+   * @param bound The exclusive upper bound.
+   * @returns Number of elements less than bound.
+   */
+  size_t count_lt(const Extended<T>& bound) const {
+    size_t total = 0;
+    for (size_t b = 0; b < m_blocks.size(); ++b) {
+      const auto& blk = m_blocks[b];
+      if (!(blk.min < bound)) continue;
+      if (blk.max < bound) {
+        total += blk.count();
+      } else {
+        total += scan(b, bound, true);
+      }
+    }
+    return total;
+  }
+
+  /**
+   * Counts elements greater than bound, skipping blocks whose max <= bound
+   * and counting blocks whose min > bound without a scan.
+   * @param bound The exclusive lower bound.
+   * @returns Number of elements greater than bound.
+   */
+  size_t count_gt(const Extended<T>& bound) const {
+    size_t total = 0;
+    for (size_t b = 0; b < m_blocks.size(); ++b) {
+      const auto& blk = m_blocks[b];
+      if (!(bound < blk.max)) continue;
+      if (bound < blk.min) {
+        total += blk.count();
+      } else {
+        total += scan(b, bound, false);
+      }
+    }
+    return total;
+  }
+
+  /**
+   * Sum with the rules of operator+=. Infinite results are decided from
+   * the block counts alone; otherwise every block takes the primitive path.
+   * THROWS: infinite_error if the column holds both +inf and -inf.
+   * @returns The sum of all elements.
+   */
+  Extended<T> sum() const {
+    size_t pos_inf = 0, neg_inf = 0;
+    for (const auto& blk : m_blocks) {
+      pos_inf += blk.pos_inf;
+      neg_inf += blk.neg_inf;
+    }
+    if (pos_inf && neg_inf)
+      throw infinite_error("Indeterminate form: +inf + -inf");
+    if (pos_inf) return Extended<T>(INF::POS);
+    if (neg_inf) return Extended<T>(INF::NEG);
+    T total = static_cast<T>(0);
+    for (const auto& num : m_data) {
+      total = static_cast<T>(total + num.raw_value());
+    }
+    return Extended<T>(total);
+  }
+};
+}  // namespace ext